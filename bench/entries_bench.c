@@ -0,0 +1,85 @@
+// Lookups by (type, pa_index) through the hash index against the linear scan it replaced, and the rebuild after a
+// reorder.  Runs with 10, 100, 1000 and 5000 entries, or with the number of entries given.
+#include "app.h"
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define ROUNDS 200000
+
+static double now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int linear_find(const Entries *ents, entry_type type, uint32_t index) {
+	for (size_t i = 0; i < ents->len; i++) {
+		if (ents->items[i].pa_index == index && ents->items[i].type == type)
+			return (int)i;
+	}
+	return -1;
+}
+
+static void run(size_t n) {
+	Entries ents = {0};
+	for (size_t i = 0; i < n; i++) {
+		Entry ent = {.type = ENTRY_SINKINPUT, .pa_index = (uint32_t)(i * 7 + 3), .channels = 2, .volume_lock = true};
+		entries_append(&ents, ent);
+	}
+
+	uint32_t *keys = malloc(ROUNDS * sizeof(*keys));
+	assert(keys != NULL);
+	srand(1);
+	for (size_t i = 0; i < ROUNDS; i++)
+		keys[i] = (uint32_t)((rand() % n) * 7 + 3);
+
+	// the sums keep the lookups from being optimized out
+	long sum = 0;
+	double start = now_ns();
+	for (size_t i = 0; i < ROUNDS; i++)
+		sum += entries_find(&ents, ENTRY_SINKINPUT, keys[i]);
+	double hashed = (now_ns() - start) / ROUNDS;
+
+	start = now_ns();
+	for (size_t i = 0; i < ROUNDS; i++)
+		sum -= linear_find(&ents, ENTRY_SINKINPUT, keys[i]);
+	double scanned = (now_ns() - start) / ROUNDS;
+	assert(sum == 0);
+
+	// a reorder moves the items in place and rebuilds the index and the line sums
+	size_t rounds = ROUNDS / n > 0 ? ROUNDS / n : 1;
+	start = now_ns();
+	for (size_t r = 0; r < rounds; r++) {
+		for (size_t i = n - 1; i > 0; i--) {
+			size_t j = rand() % (i + 1);
+			Entry tmp = ents.items[i];
+			ents.items[i] = ents.items[j];
+			ents.items[j] = tmp;
+		}
+		entries_reindex(&ents);
+	}
+	double reindexed = (now_ns() - start) / rounds;
+
+	printf("%zu entries: find %.1f ns, linear scan %.1f ns, shuffle and reindex %.1f us\n", n, hashed, scanned,
+	       reindexed / 1000);
+	free(keys);
+	entries_free(&ents);
+}
+
+int main(int argc, char **argv) {
+	if (argc > 1) {
+		long n = strtol(argv[1], NULL, 10);
+		if (n < 1) {
+			fprintf(stderr, "usage: %s [entries], at least 1\n", argv[0]);
+			return 1;
+		}
+		run((size_t)n);
+		return 0;
+	}
+	static const size_t sizes[] = {10, 100, 1000, 5000};
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(*sizes); i++)
+		run(sizes[i]);
+	return 0;
+}
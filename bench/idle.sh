@@ -0,0 +1,42 @@
+#!/bin/sh
+# Context switches and threads of an idle pamix, with the threaded mainloop and with `set single-thread on`.  Each mode
+# runs on its own pseudo-terminal for a few seconds without keys, the switches of all its threads are read from /proc.
+# Run it with a PulseAudio server for the idle cost while connected, without one it measures the wait for the server.
+#   bench/idle.sh path/to/pamix [seconds]
+set -eu
+
+pamix=$(realpath "${1:?usage: $0 path/to/pamix [seconds]}")
+seconds=${2:-10}
+conf=$(dirname "$0")/../pamix.conf
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+
+# voluntary and involuntary switches summed over the threads of `$1`
+switches() {
+	cat /proc/"$1"/task/*/status | awk '/ctxt_switches/ { n += $2 } END { print n }'
+}
+
+for mode in off on; do
+	mkdir -p "$tmp/$mode"
+	sed "s/^set single-thread .*/set single-thread $mode/; s/^set snapshot .*/set snapshot off/" "$conf" \
+		>"$tmp/$mode/pamix.conf"
+	# the pipe keeps the terminal's input open and idle
+	sleep $((seconds + 5)) | XDG_CONFIG_HOME="$tmp/$mode" script -qc "exec $pamix" /dev/null >/dev/null &
+	runner=$!
+	# let it set up the screen and the context first
+	sleep 1
+	pid=$(pgrep -n -x -f "$pamix" || true)
+	if [ -z "$pid" ]; then
+		echo "pamix did not start" >&2
+		pkill -P $$ -x sleep 2>/dev/null || true
+		exit 1
+	fi
+	before=$(switches "$pid")
+	sleep "$seconds"
+	after=$(switches "$pid")
+	threads=$(ls /proc/"$pid"/task | wc -l)
+	kill "$pid" 2>/dev/null || true
+	pkill -P $$ -x sleep 2>/dev/null || true
+	wait "$runner" 2>/dev/null || true
+	echo "single-thread $mode: $threads threads, $(( (after - before) / seconds )) switches/s"
+done
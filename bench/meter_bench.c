@@ -0,0 +1,124 @@
+// Terminal output of the meter frames with 50 playing streams: bytes and time per frame when every bar is redrawn, when
+// only the cells that changed are redrawn, and with the whole-cell levels of an output budget.  The screen is a
+// 120x220 xterm written to a temporary file, so all streams are on it.  Run with the number of streams to change that.
+#define main pamix_main
+#include "../src/main.c"
+#undef main
+#include <math.h>
+#include <time.h>
+
+#define FRAMES 2000
+
+static double now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// a level wandering around a few slow waves with some noise, like music at the meter rate
+static float next_peak(unsigned stream, unsigned frame) {
+	float t = frame / 40.0f;
+	float level = 0.45f + 0.25f * sinf(t * (1.3f + stream * 0.07f)) + 0.1f * sinf(t * 7.1f + stream);
+	level += 0.08f * ((float)rand() / RAND_MAX - 0.5f);
+	return level < 0 ? 0 : level > 1 ? 1 : level;
+}
+
+// `redraw` draws the meters of one frame, returns the bytes written per frame
+static double run(const char *what, FILE *out, const Config *cfg, Monitor *mons, unsigned streams, bool whole,
+                  void (*redraw)(const Config *)) {
+	output_budget.limit = whole ? 1 : 0;
+	srand(1);
+	paint_full(cfg);
+	refresh();
+	fflush(out);
+	long start_bytes = ftell(out);
+	double took = 0;
+	for (unsigned f = 0; f < FRAMES; f++) {
+		for (unsigned s = 0; s < streams; s++) {
+			float peak = next_peak(s, f);
+			float hold = monitor_hold(&mons[s]) * 0.98f;
+			float_store(&mons[s].peak, peak);
+			float_store(&mons[s].hold, peak > hold ? peak : hold);
+		}
+		double start = now_ns();
+		redraw(cfg);
+		refresh();
+		took += now_ns() - start;
+	}
+	fflush(out);
+	double bytes = (double)(ftell(out) - start_bytes) / FRAMES;
+	printf("%-22s %7.0f bytes, %6.1f us per frame, %5.0f KiB per minute at 40 fps\n", what, bytes,
+	       took / FRAMES / 1000, bytes * 40 * 60 / 1024);
+	return bytes;
+}
+
+// every bar with its brackets, as before the meters kept their last level
+static void redraw_bars(const Config *cfg) {
+	for (size_t i = 0; i < entry_lines.len; i++)
+		draw_meter(&entry_lines.items[i], cfg->peak_hold_ms != 0, true);
+}
+
+int main(int argc, char **argv) {
+	unsigned streams = 50;
+	if (argc > 1) {
+		long n = strtol(argv[1], NULL, 10);
+		if (n < 1 || n > 200) {
+			fprintf(stderr, "usage: %s [streams], 1 to 200\n", argv[0]);
+			return 1;
+		}
+		streams = (unsigned)n;
+	}
+
+	setlocale(LC_ALL, "C.UTF-8");
+	setenv("LINES", "220", 1);
+	setenv("COLUMNS", "120", 1);
+	FILE *out = tmpfile();
+	FILE *in = fopen("/dev/null", "r");
+	if (out == NULL || in == NULL || newterm("xterm-256color", out, in) == NULL) {
+		fprintf(stderr, "could not set up the terminal\n");
+		return 1;
+	}
+	start_color();
+	init_pair(1, COLOR_GREEN, COLOR_BLACK);
+	init_pair(2, COLOR_YELLOW, COLOR_BLACK);
+	init_pair(3, COLOR_RED, COLOR_BLACK);
+
+	Config cfg = {0};
+	cfg.peak_hold_ms = 1000;
+	app_init(&app, NULL, NULL, pa_mainloop_new());
+	app.entry_page = ENTRY_SINKINPUT;
+	// the references keep the monitors away from the manager, which never opened them
+	Monitor *mons = calloc(streams, sizeof(*mons));
+	if (mons == NULL) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	for (unsigned s = 0; s < streams; s++) {
+		mons[s].refs = UINT_MAX / 2;
+		EntryDetail *detail = calloc(1, sizeof(*detail));
+		if (detail == NULL) {
+			fprintf(stderr, "out of memory\n");
+			return 1;
+		}
+		pa_channel_map_init_stereo(&detail->channel_map);
+		pa_cvolume_set(&detail->volume, 2, PA_VOLUME_NORM);
+		char title[32];
+		snprintf(title, sizeof(title), "Stream %u", s);
+		label_set(&detail->title, title);
+		label_set(&detail->subtitle, "bench");
+		entries_append(&app.entries[ENTRY_SINKINPUT], (Entry){
+			.type = ENTRY_SINKINPUT,
+			.pa_index = s,
+			.channels = 2,
+			.volume_lock = true,
+			.monitor = &mons[s],
+			.detail = detail,
+		});
+	}
+
+	run("whole bars", out, &cfg, mons, streams, false, &redraw_bars);
+	run("changed cells", out, &cfg, mons, streams, false, &paint_meters);
+	run("changed whole cells", out, &cfg, mons, streams, true, &paint_meters);
+	endwin();
+	return 0;
+}
@@ -0,0 +1,139 @@
+// Key-to-paint cost of moving the selection among 200 streams on a 120x50 xterm written to a temporary file, within
+// the screen and through the whole page, which scrolls on most keys.  The frame repaints the rows of the two entries
+// changed by the key, or everything after a scroll, against the refresh pass and full paint navigation used to run.
+// The context state is replaced through `-Wl,--wrap` so the refresh pass runs without a server, none of its other
+// steps talk to one while nothing changed.  Run with the number of streams to change that.
+#define main pamix_main
+#include "../src/main.c"
+#undef main
+#include <time.h>
+
+#define KEYS 20000
+
+pa_context_state_t __wrap_pa_context_get_state(const pa_context *c) {
+	(void)c;
+	return PA_CONTEXT_READY;
+}
+
+static double now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// the steps of a frame in the main loop, without the meters
+static void frame(const Config *cfg) {
+	if (atomic_exchange(&app.should_refresh, false))
+		app_refresh_entries(&app);
+	if (atomic_exchange(&app.should_redraw, false)) {
+		atomic_store(&app.should_update, false);
+		paint_full(cfg);
+	} else if (atomic_exchange(&app.should_update, false)) {
+		paint_rows(cfg);
+	}
+	refresh();
+}
+
+// Average time from queueing a key to the painted frame, the selection moves down and back up over `span` entries
+// from the top.  `refresh_all` runs the frame navigation used to run.
+static void run(const char *what, FILE *out, const Config *cfg, size_t span, bool refresh_all) {
+	app.selected_entry = 0;
+	app.selected_channel = 0;
+	app.scroll = 0;
+	atomic_store(&app.should_redraw, true);
+	frame(cfg);
+	fflush(out);
+	long start_bytes = ftell(out);
+	double took = 0;
+	for (size_t k = 0; k < KEYS; k++) {
+		int key = (k / (span - 1)) % 2 == 0 ? 'j' : 'k';
+		double start = now_ns();
+		input_queue_push(&app.input_queue, (InputEvent){.keycode = key, .keyname = key == 'j' ? "j" : "k"});
+		drain_input_queue(cfg);
+		if (refresh_all) {
+			atomic_store(&app.should_refresh, true);
+			atomic_store(&app.should_redraw, true);
+		}
+		frame(cfg);
+		took += now_ns() - start;
+	}
+	fflush(out);
+	printf("%-36s %6.1f us, %5.0f bytes per key\n", what, took / KEYS / 1000,
+	       (double)(ftell(out) - start_bytes) / KEYS);
+}
+
+int main(int argc, char **argv) {
+	size_t streams = 200;
+	if (argc > 1) {
+		long n = strtol(argv[1], NULL, 10);
+		if (n < 2) {
+			fprintf(stderr, "usage: %s [streams], at least 2\n", argv[0]);
+			return 1;
+		}
+		streams = (size_t)n;
+	}
+
+	setlocale(LC_ALL, "C.UTF-8");
+	setenv("LINES", "50", 1);
+	setenv("COLUMNS", "120", 1);
+	FILE *out = tmpfile();
+	FILE *in = fopen("/dev/null", "r");
+	if (out == NULL || in == NULL || newterm("xterm-256color", out, in) == NULL) {
+		fprintf(stderr, "could not set up the terminal\n");
+		return 1;
+	}
+	start_color();
+	init_pair(1, COLOR_GREEN, COLOR_BLACK);
+	init_pair(2, COLOR_YELLOW, COLOR_BLACK);
+	init_pair(3, COLOR_RED, COLOR_BLACK);
+
+	Config cfg = {0};
+	cfg.keymap['j'] = (Action){.type = ACTION_ENTRY_NEXT};
+	cfg.keymap['k'] = (Action){.type = ACTION_ENTRY_PREV};
+	static char context;
+	app_init(&app, (pa_context *)&context, NULL, pa_mainloop_new());
+	app.entry_page = ENTRY_SINKINPUT;
+	app.sort_key = SORT_NAME;
+	// one stream per monitor, as after the refresh pass acquired them.  The references keep the monitors away from the
+	// manager, which never opened them.
+	static char stream;
+	Monitor *mons = calloc(streams, sizeof(*mons));
+	if (mons == NULL) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	for (size_t s = 0; s < streams; s++) {
+		mons[s] = (Monitor){.kind = MONITOR_SINKINPUT, .index = (uint32_t)s, .stream = (pa_stream *)&stream,
+		                    .refs = UINT_MAX / 2};
+		EntryDetail *detail = calloc(1, sizeof(*detail));
+		if (detail == NULL) {
+			fprintf(stderr, "out of memory\n");
+			return 1;
+		}
+		pa_channel_map_init_stereo(&detail->channel_map);
+		pa_cvolume_set(&detail->volume, 2, PA_VOLUME_NORM);
+		char title[32];
+		snprintf(title, sizeof(title), "Stream %03zu", s);
+		label_set(&detail->title, title);
+		label_set(&detail->subtitle, "bench");
+		detail->data.device.index = PA_INVALID_INDEX;
+		entries_append(&app.entries[ENTRY_SINKINPUT], (Entry){
+			.type = ENTRY_SINKINPUT,
+			.pa_index = (uint32_t)s,
+			.channels = 2,
+			.volume_lock = true,
+			.name = intern(title),
+			.monitor = &mons[s],
+			.detail = detail,
+		});
+	}
+
+	// the entries on screen take 4 lines each
+	size_t on_screen = (50 - 2) / 4 < streams ? (50 - 2) / 4 : streams;
+	run("on screen, dirty rows", out, &cfg, on_screen, false);
+	run("on screen, refresh and full paint", out, &cfg, on_screen, true);
+	run("whole page, dirty rows or full paint", out, &cfg, streams, false);
+	run("whole page, refresh and full paint", out, &cfg, streams, true);
+	endwin();
+	return 0;
+}
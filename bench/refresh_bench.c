@@ -0,0 +1,154 @@
+// The passes over all entries of a tab at large entry counts: lookup, ordering after updates, culling after a
+// resync, the line sums of the scroll computation, and the peak updates with the activity sync of the peak sort key.
+// Runs with 1000, 10000 and 50000 entries, or with the number of entries given.
+#include "../src/app.c"
+#include <limits.h>
+#include <time.h>
+
+// entry-visits per measurement, spread over as many rounds as the size needs
+#define WORK 4000000
+
+static double now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static uint32_t next_index;
+
+static Entry new_entry(Monitor *mon) {
+	char name[32];
+	snprintf(name, sizeof(name), "stream %08d", rand());
+	EntryDetail *detail = calloc(1, sizeof(*detail));
+	assert(detail != NULL);
+	return (Entry){
+		.type = ENTRY_SINKINPUT,
+		.pa_index = next_index++,
+		.channels = 2,
+		.volume_lock = true,
+		.reorder = true,
+		.name = intern(name),
+		.application = strdup("bench"),
+		.monitor = mon,
+		.detail = detail,
+	};
+}
+
+// flag `count` random entries for reordering
+static void flag_reorder(Entries *ents, size_t count) {
+	for (size_t k = 0; k < count; k++)
+		ents->items[rand() % ents->len].reorder = true;
+	ents->reorder = true;
+}
+
+static void run(size_t n) {
+	Entries *ents = &app.entries[ENTRY_SINKINPUT];
+	app.entry_page = ENTRY_SINKINPUT;
+	app.sort_key = SORT_NAME;
+	srand(1);
+
+	// four entries per monitor, like the streams of a few busy applications.  The references keep the monitors away
+	// from the manager, which never opened them.
+	size_t n_mons = n / 4 + 1;
+	Monitor *mons = calloc(n_mons, sizeof(*mons));
+	assert(mons != NULL);
+	for (size_t m = 0; m < n_mons; m++)
+		mons[m].refs = UINT_MAX / 2;
+	for (size_t i = 0; i < n; i++)
+		entries_append(ents, new_entry(&mons[i / 4]));
+	flag_reorder(ents, n);
+	double start = now_ns();
+	order_entries(&app, ents);
+	double sorted = (now_ns() - start) / 1000;
+
+	size_t rounds = WORK / n > 0 ? WORK / n : 1;
+	long found = 0;
+	start = now_ns();
+	for (size_t r = 0; r < rounds; r++) {
+		for (size_t i = 0; i < n; i++)
+			found += entries_find(ents, ENTRY_SINKINPUT, ents->items[i].pa_index) == (int)i;
+	}
+	double lookup = (now_ns() - start) / (rounds * n);
+	assert(found == (long)(rounds * n));
+
+	// updates flag about 1% of the entries between two refreshes
+	size_t changed = n / 100 > 0 ? n / 100 : 1;
+	rounds = WORK / n / 10 > 0 ? WORK / n / 10 : 1;
+	double ordering = 0;
+	for (size_t r = 0; r < rounds; r++) {
+		flag_reorder(ents, changed);
+		start = now_ns();
+		order_entries(&app, ents);
+		ordering += now_ns() - start;
+	}
+	ordering /= rounds * 1000;
+
+	// a resync drops about 1% of the entries, the new ones are appended untimed
+	double culling = 0;
+	for (size_t r = 0; r < rounds; r++) {
+		for (size_t k = 0; k < changed; k++)
+			ents->items[rand() % ents->len].marked = true;
+		start = now_ns();
+		cull_entries(ents);
+		culling += now_ns() - start;
+		while (ents->len < n)
+			entries_append(ents, new_entry(&mons[rand() % n_mons]));
+		ents->reorder = true;
+		order_entries(&app, ents);
+	}
+	culling /= rounds * 1000;
+
+	rounds = WORK / n > 0 ? WORK / n : 1;
+	// the first line of a scroll position and the entries fitting a 50-line terminal from there
+	size_t fit = 0;
+	start = now_ns();
+	for (size_t r = 0; r < rounds; r++)
+		fit += entries_fit(ents, entries_lines_before(ents, rand() % n) + 50);
+	double scroll = (now_ns() - start) / rounds;
+	assert(fit > 0);
+
+	// every monitor gets a fragment, half of them flip their activity, then the refresh copies it into the entries
+	app.sort_key = SORT_PEAK;
+	rounds = WORK / n / 10 > 0 ? WORK / n / 10 : 1;
+	double peaks = 0;
+	double syncing = 0;
+	for (size_t r = 0; r < rounds; r++) {
+		start = now_ns();
+		for (size_t m = 0; m < n_mons; m++)
+			app_monitor_peak(&mons[m], 0.5f, (m + r) % 2 ? 0.1f : 0);
+		peaks += now_ns() - start;
+		start = now_ns();
+		if (atomic_exchange(&app.activity_changed, false))
+			sync_activity(&app);
+		order_entries(&app, ents);
+		syncing += now_ns() - start;
+	}
+	peaks /= rounds * n_mons;
+	syncing /= rounds * 1000;
+
+	printf("%6zu entries: full sort %8.1f us, find %5.1f ns, 1%% reorder %7.1f us, 1%% cull %7.1f us, "
+	       "scroll %5.1f ns, peak %5.1f ns per monitor, activity sync and reorder %8.1f us\n",
+	       n, sorted, lookup, ordering, culling, scroll, peaks, syncing);
+
+	for (size_t i = 0; i < ents->len; i++)
+		entry_free(&ents->items[i]);
+	entries_free(ents);
+	*ents = (Entries){0};
+	free(mons);
+}
+
+int main(int argc, char **argv) {
+	if (argc > 1) {
+		long n = strtol(argv[1], NULL, 10);
+		if (n < 1) {
+			fprintf(stderr, "usage: %s [entries], at least 1\n", argv[0]);
+			return 1;
+		}
+		run((size_t)n);
+		return 0;
+	}
+	static const size_t sizes[] = {1000, 10000, 50000};
+	for (size_t i = 0; i < sizeof(sizes) / sizeof(*sizes); i++)
+		run(sizes[i]);
+	return 0;
+}
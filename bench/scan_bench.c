@@ -0,0 +1,82 @@
+// The vector float32 scan of the monitor fragments against the scalar loop, and the cost of a fragment in each
+// meter-format.  Run with the number of channels and the frames per fragment, 2 and 512 by default.
+#include "scan.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define ROUNDS 20000
+
+static double now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+// keeps the scans from being optimized out
+static volatile float sink;
+
+// the scanners of each format behind one signature
+static void run_float32(const void *samples, size_t frames, unsigned channels, float *ch_max, float *sumsq) {
+	scan_float32(samples, frames, channels, ch_max, sumsq);
+}
+
+static void run_float32_scalar(const void *samples, size_t frames, unsigned channels, float *ch_max, float *sumsq) {
+	scan_float32_scalar(samples, frames, channels, ch_max, sumsq);
+}
+
+static void run_s16(const void *samples, size_t frames, unsigned channels, float *ch_max, float *sumsq) {
+	scan_s16(samples, frames, channels, ch_max, sumsq);
+}
+
+static void run_u8(const void *samples, size_t frames, unsigned channels, float *ch_max, float *sumsq) {
+	scan_u8(samples, frames, channels, ch_max, sumsq);
+}
+
+static double measure(void (*scan)(const void *, size_t, unsigned, float *, float *), const void *samples,
+                      size_t frames, unsigned channels) {
+	float ch_max[32], sumsq;
+	double start = now_ns();
+	for (size_t r = 0; r < ROUNDS; r++) {
+		scan(samples, frames, channels, ch_max, &sumsq);
+		sink = sumsq + ch_max[0];
+	}
+	return (now_ns() - start) / ROUNDS;
+}
+
+int main(int argc, char **argv) {
+	unsigned channels = argc > 1 ? (unsigned)strtoul(argv[1], NULL, 10) : 2;
+	size_t frames = argc > 2 ? strtoul(argv[2], NULL, 10) : 512;
+	assert(channels >= 1 && channels <= 32);
+
+	size_t n = frames * channels;
+	float *samples = malloc(n * sizeof(*samples));
+	int16_t *samples_s16 = malloc(n * sizeof(*samples_s16));
+	uint8_t *samples_u8 = malloc(n * sizeof(*samples_u8));
+	assert(samples != NULL && samples_s16 != NULL && samples_u8 != NULL);
+	srand(1);
+	for (size_t i = 0; i < n; i++) {
+		samples[i] = (float)rand() / RAND_MAX * 2 - 1;
+		samples_s16[i] = (int16_t)(samples[i] * 32767);
+		samples_u8[i] = (uint8_t)(samples[i] * 127 + 128);
+	}
+
+	double vector = measure(&run_float32, samples, frames, channels);
+	double scalar = measure(&run_float32_scalar, samples, frames, channels);
+	printf("%u channels, %zu frames: vector %.1f ns, scalar %.1f ns (%.1fx)\n", channels, frames, vector, scalar,
+	       scalar / vector);
+
+	// per fragment and per frame, next to the bytes each format moves from the server
+	double s16 = measure(&run_s16, samples_s16, frames, channels);
+	double u8 = measure(&run_u8, samples_u8, frames, channels);
+	printf("float32 %.1f ns (%.2f ns/frame, %zu bytes), s16 %.1f ns (%.2f ns/frame, %zu bytes), "
+	       "u8 %.1f ns (%.2f ns/frame, %zu bytes)\n",
+	       vector, vector / frames, n * sizeof(float), s16, s16 / frames, n * sizeof(int16_t), u8, u8 / frames,
+	       n * sizeof(uint8_t));
+	free(samples);
+	free(samples_s16);
+	free(samples_u8);
+	return 0;
+}
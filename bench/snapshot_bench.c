@@ -0,0 +1,121 @@
+// Loading the snapshot that the first frame is painted from, with the file in the page cache (warm) and dropped from it
+// before every load (cold).  Runs with 200 and 2000 streams next to 20 sinks, 20 sources and 10 cards, or with the
+// number of streams given.  The snapshot is written to $TMPDIR, which should be on a disk for the cold numbers, a
+// tmpfs keeps the file in memory.
+#include "../src/snapshot.c"
+#include <time.h>
+
+#define ROUNDS 200
+
+static double now_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void add_entry(entry_type type, uint32_t index) {
+	char text[64];
+	EntryDetail *detail = calloc(1, sizeof(*detail));
+	assert(detail != NULL);
+	pa_channel_map_init_stereo(&detail->channel_map);
+	pa_cvolume_set(&detail->volume, 2, PA_VOLUME_NORM);
+	snprintf(text, sizeof(text), "Playback stream number %u", index);
+	label_set(&detail->title, text);
+	label_set(&detail->subtitle, "Some Application");
+	if (type == ENTRY_SINKINPUT || type == ENTRY_SOURCEOUTPUT) {
+		detail->data.device.index = index % 20;
+	} else {
+		detail->data.ports.current = 0;
+		for (unsigned p = 0; p < 4; p++) {
+			snprintf(text, sizeof(text), "analog-output-%u", p);
+			NameDesc port = {.name = intern(text)};
+			snprintf(text, sizeof(text), "Analog Output %u", p);
+			port.description = intern(text);
+			da_append(&detail->data.ports, port);
+		}
+	}
+	snprintf(text, sizeof(text), "entry.%u", index);
+	Entry ent = {
+		.type = type,
+		.pa_index = index,
+		.monitor_index = index,
+		.channels = 2,
+		.volume_lock = true,
+		.name = intern(text),
+		.application = strdup("some-application"),
+		.detail = detail,
+	};
+	entries_append(&app.entries[type], ent);
+}
+
+// one load, the caches are emptied again untimed
+static double load(const char *path, bool cold) {
+	if (cold) {
+		int fd = open(path, O_RDONLY);
+		assert(fd >= 0);
+		posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+		close(fd);
+	}
+	double start = now_ns();
+	bool ok = snapshot_load(path);
+	double took = now_ns() - start;
+	if (!ok) {
+		fprintf(stderr, "failed to load %s\n", path);
+		exit(1);
+	}
+	clear_all();
+	return took;
+}
+
+static void run(const char *path, unsigned streams) {
+	for (uint32_t i = 0; i < 20; i++) {
+		add_entry(ENTRY_SINK, i);
+		add_entry(ENTRY_SOURCE, i);
+		DeviceName sink = {.index = i}, source = {.index = i};
+		label_set(&sink.description, "Built-in Audio Analog Stereo");
+		label_set(&source.description, "Monitor of Built-in Audio Analog Stereo");
+		da_append(&app.sink_names, sink);
+		da_append(&app.source_names, source);
+	}
+	for (uint32_t i = 0; i < 10; i++)
+		add_entry(ENTRY_CARD, i);
+	for (uint32_t i = 0; i < streams; i++)
+		add_entry(i % 4 == 3 ? ENTRY_SOURCEOUTPUT : ENTRY_SINKINPUT, i);
+	if (!snapshot_save(path)) {
+		fprintf(stderr, "failed to save %s\n", path);
+		exit(1);
+	}
+	struct stat st;
+	stat(path, &st);
+	clear_all();
+
+	double warm = 0, cold = 0;
+	load(path, false);
+	for (size_t r = 0; r < ROUNDS; r++) {
+		warm += load(path, false);
+		cold += load(path, true);
+	}
+	printf("%4u streams, %7lld bytes: warm %7.1f us, cold %7.1f us\n", streams, (long long)st.st_size,
+	       warm / ROUNDS / 1000, cold / ROUNDS / 1000);
+}
+
+int main(int argc, char **argv) {
+	const char *dir = getenv("TMPDIR");
+	char path[PATH_MAX];
+	snprintf(path, sizeof(path), "%s/pamix-bench.%d/pamix.snapshot", dir != NULL ? dir : "/tmp", (int)getpid());
+	if (argc > 1) {
+		long streams = strtol(argv[1], NULL, 10);
+		if (streams < 0) {
+			fprintf(stderr, "usage: %s [streams]\n", argv[0]);
+			return 1;
+		}
+		run(path, (unsigned)streams);
+	} else {
+		run(path, 200);
+		run(path, 2000);
+	}
+	unlink(path);
+	*strrchr(path, '/') = '\0';
+	rmdir(path);
+	return 0;
+}
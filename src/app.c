@@ -1,5 +1,6 @@
 #include "app.h"
 #include "da.h"
+#include "intern.h"
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -8,161 +9,180 @@ static void entry_data_free(Entry *entry);
 
 App app = {0};
 
-struct entry_indices {
-	uint32_t *indices;
-	int count;
-};
-
-static struct entry_indices *cmp_entry_indices;
-// this cmp function splits entries into two groups: corked and uncorked.  The sorting is stabelized by passing the
-// original order as the context argument, so order within groups doesnt change, only the uncorked streams are brought
-// to the front.
-// `cmd_entry_indices` needs to be set when running qsort.  This is not threadsafe.
-static int cmp_entry(const void *pa, const void *pb) {
-	const Entry *a = pa;
-	const Entry *b = pb;
-	assert(a->pa_index != b->pa_index);
-	if(a->corked != b->corked) {
-		return a->corked - b->corked;
-	}
-	struct entry_indices *indices = cmp_entry_indices;
-	int ia = -1;
-	int ib = -1;
-	for(int i = 0; i < indices->count; i++) {
-		if(indices->indices[i] == a->pa_index)
-			ia = i;
-		else if(indices->indices[i] == b->pa_index)
-			ib = i;
+// levels below this count as silence for the peak sort key
+#define PEAK_ACTIVE_THRESHOLD 0.001f
 
-		if(ia != -1 && ib != -1)
-			break;
-	}
-	assert(ia != -1);
-	assert(ib != -1);
-	return ia - ib;
+static bool entry_active(const Entry *ent) {
+	return ent->monitor != NULL && ent->active;
 }
 
-static void cull_entries(Entries *ents) {
-	for (int i = (int)ents->len - 1; i >= 0; i--) {
-		Entry *ent = &ents->items[i];
-		if (!ents->items[i].marked)
-			continue;
-		entry_free(ent);
-		memmove(ents->items + i, ents->items + i + 1, (ents->len - i - 1) * sizeof(Entry));
-		ents->len--;
+// uncorked entries come first, within those groups entries are ordered by the configured key.  Ties are kept in their
+// current order by the callers.
+static int cmp_entry_order(const Entry *a, const Entry *b, sort_key key) {
+	if (a->corked != b->corked)
+		return a->corked - b->corked;
+	switch (key) {
+	case SORT_NONE:
+		return 0;
+	case SORT_NAME:
+		return strcmp(a->name, b->name);
+	case SORT_APPLICATION:
+		return strcmp(a->application, b->application);
+	case SORT_PEAK:
+		return entry_active(b) - entry_active(a);
+	case SORT_DEVICE:
+		if (a->type != ENTRY_SINKINPUT && a->type != ENTRY_SOURCEOUTPUT)
+			return strcmp(a->name, b->name);
+		return (a->detail->data.device.index > b->detail->data.device.index) -
+		       (a->detail->data.device.index < b->detail->data.device.index);
 	}
+	__builtin_unreachable();
 }
 
-static void cb_monitor_read(pa_stream *stream, size_t nbytes, void *pdata) {
-	uint32_t index = (uintptr_t)pdata;
-	const void *data;
-	int err = pa_stream_peek(stream, &data, &nbytes);
-	if (err != 0) {
-		return;
-	}
-	assert(nbytes >= sizeof(float));
-	assert((nbytes % sizeof(float)) == 0);
-	float last_peak = ((float *)data)[nbytes / sizeof(float) - 1];
+static struct {
+	Entry *items;
+	size_t len;
+	size_t cap;
+} order_scratch;
 
-	pa_stream_drop(stream);
-
-	pthread_mutex_lock(&app.mutex);
-	for (size_t i = 0; i < app.entries.len; i++) {
-		Entry *ent = &app.entries.items[i];
-		if (ent->pa_index == index || ent->monitor_index == index) {
-			if (ent->monitor_stream != stream)
-				break;
-			assert(ent->monitor_stream == stream);
-			ent->peak = last_peak;
-			app.new_peaks = true;
-			pa_threaded_mainloop_signal(app.pa_mainloop, false);
-			break;
+// stable bottom-up merge sort of `n` entries, `tmp` needs room for `n` entries
+static void merge_sort_entries(Entry *items, Entry *tmp, size_t n, sort_key key) {
+	for (size_t width = 1; width < n; width *= 2) {
+		for (size_t lo = 0; lo < n; lo += 2 * width) {
+			size_t mid = lo + width < n ? lo + width : n;
+			size_t hi = lo + 2 * width < n ? lo + 2 * width : n;
+			size_t i = lo, j = mid, k = lo;
+			while (i < mid && j < hi)
+				tmp[k++] = cmp_entry_order(&items[j], &items[i], key) < 0 ? items[j++] : items[i++];
+			while (i < mid)
+				tmp[k++] = items[i++];
+			while (j < hi)
+				tmp[k++] = items[j++];
 		}
+		memcpy(items, tmp, n * sizeof(*items));
 	}
-	pthread_mutex_unlock(&app.mutex);
 }
 
-static void cb_monitor_state(pa_stream *stream, void *data) {
-	(void)data;
-	pa_stream_state_t state = pa_stream_get_state(stream);
-	if (state == PA_STREAM_FAILED || state == PA_STREAM_TERMINATED) {
-		pthread_mutex_lock(&app.mutex);
-		for (size_t i = 0; i < app.entries.len; i++) {
-			Entry *ent = &app.entries.items[i];
-			if (ent->monitor_stream == stream) {
-				ent->monitor_stream = NULL;
-				ent->peak = 0;
-				break;
+// Restores the entry order after updates flagged entries with `reorder`.  Without a sort key this is a single stable
+// partition pass.  With a key only the flagged entries are sorted and merged back into the unflagged ones, which are
+// still in order since they didn't change.  Returns whether entries were added or moved, which changes the layout.
+// caller should hold app-mutex
+static bool order_entries(App *app, Entries *ents) {
+	if (!ents->reorder)
+		return false;
+	ents->reorder = false;
+
+	bool has_selected = ents == app_page(app) && app->selected_entry < (int)ents->len;
+	entry_type selected_type = has_selected ? ents->items[app->selected_entry].type : app->entry_page;
+	uint32_t selected_index = has_selected ? ents->items[app->selected_entry].pa_index : PA_INVALID_INDEX;
+
+	order_scratch.len = 0;
+	da_reserve(&order_scratch, ents->len * 2);
+	Entry *moved = order_scratch.items;
+	size_t kept = 0;
+	size_t n_moved = 0;
+	if (app->sort_key == SORT_NONE) {
+		for (size_t i = 0; i < ents->len; i++) {
+			ents->items[i].reorder = false;
+			if (ents->items[i].corked)
+				moved[n_moved++] = ents->items[i];
+			else
+				ents->items[kept++] = ents->items[i];
+		}
+		memcpy(ents->items + kept, moved, n_moved * sizeof(*moved));
+	} else {
+		for (size_t i = 0; i < ents->len; i++) {
+			if (ents->items[i].reorder) {
+				ents->items[i].reorder = false;
+				moved[n_moved++] = ents->items[i];
+			} else {
+				ents->items[kept++] = ents->items[i];
 			}
 		}
-		pthread_mutex_unlock(&app.mutex);
-		return;
+		merge_sort_entries(moved, moved + n_moved, n_moved, app->sort_key);
+		// merge from the back, so it can happen in place
+		size_t k = ents->len;
+		while (n_moved > 0) {
+			if (kept > 0 && cmp_entry_order(&ents->items[kept - 1], &moved[n_moved - 1], app->sort_key) > 0)
+				ents->items[--k] = ents->items[--kept];
+			else
+				ents->items[--k] = moved[--n_moved];
+		}
 	}
+	entries_reindex(ents);
 
-	if (state == PA_STREAM_READY) {
-		pthread_mutex_lock(&app.mutex);
-		int idx = -1;
-		for (size_t i = 0; i < app.entries.len; i++) {
-			Entry *ent = &app.entries.items[i];
-			if (ent->monitor_stream == stream) {
-				idx = i;
-				break;
-			}
-		}
-		pthread_mutex_unlock(&app.mutex);
-		if (idx == -1) {
-			pa_stream_disconnect(stream);
-			pa_stream_unref(stream);
+	if (has_selected) {
+		int i = entries_find(ents, selected_type, selected_index);
+		if (i != -1)
+			app->selected_entry = i;
+	}
+	return true;
+}
+
+static void cull_entries(Entries *ents) {
+	size_t kept = 0;
+	for (size_t i = 0; i < ents->len; i++) {
+		if (ents->items[i].marked) {
+			entry_free(&ents->items[i]);
+			continue;
 		}
+		ents->items[kept++] = ents->items[i];
 	}
+	if (kept == ents->len)
+		return;
+	ents->len = kept;
+	entries_reindex(ents);
 }
 
-static pa_stream *create_monitor(pa_context *ctx, uint32_t monitor_stream, uint32_t device) {
-	char stream_name[32];
-	snprintf(stream_name, sizeof(stream_name) - 1, "PeakMonitor %d", monitor_stream);
+// keep the selection on the page after entries were removed from it
+// caller should hold app-mutex
+static void clamp_selection(App *app) {
+	Entries *ents = app_page(app);
+	if (app->selected_entry < (int)ents->len)
+		return;
+	app->selected_entry = ents->len > 0 ? (int)ents->len - 1 : 0;
+	app->selected_channel = 0;
+}
 
-	pa_sample_spec spec = {.rate = 40, .format = PA_SAMPLE_FLOAT32LE, .channels = 1};
-	pa_proplist *props = pa_proplist_new();
-	// hide monitor stream from pavucontrol
-	pa_proplist_sets(props, PA_PROP_APPLICATION_ID, "org.PulseAudio.pavucontrol");
-	pa_stream *stream = pa_stream_new_with_proplist(ctx, stream_name, &spec, NULL, props);
-	pa_proplist_free(props);
-	assert(stream != NULL);
+// Publish a new peak of `mon`, called by the monitor callbacks on the mainloop thread for every fragment.  Nothing here
+// takes app-mutex: the peak and the active state are stored lock-free, the renderer is only woken for monitors it
+// showed in its last paint and picks up changed clip counts itself.  An active flip only asks for a refresh, which
+// reorders the entries for the peak sort key.  Activity follows the RMS of the fragment, so a single click doesn't
+// count as playing.
+void app_monitor_peak(Monitor *mon, float peak, float rms) {
+	float_store(&mon->peak, peak);
 
-	char devname[16];
-	if (monitor_stream != PA_INVALID_INDEX) {
-		assert(device == PA_INVALID_INDEX);
-		int err = pa_stream_set_monitor_stream(stream, monitor_stream);
-		if (err != 0) {
-			pa_stream_unref(stream);
-			return NULL;
+	bool active = rms >= PEAK_ACTIVE_THRESHOLD;
+	if (atomic_load(&mon->active) != active) {
+		atomic_store(&mon->active, active);
+		if (app.sort_key == SORT_PEAK) {
+			atomic_store(&app.activity_changed, true);
+			atomic_store(&app.should_refresh, true);
+			app_signal(&app);
 		}
-	} else {
-		assert(device != PA_INVALID_INDEX);
-		sprintf(devname, "%u", device);
 	}
 
-	pa_stream_set_read_callback(stream, &cb_monitor_read, (void *)(uintptr_t)(monitor_stream != PA_INVALID_INDEX ? monitor_stream : device));
-	pa_stream_set_state_callback(stream, &cb_monitor_state, NULL);
-
-	pa_stream_flags_t flags = (pa_stream_flags_t)(PA_STREAM_DONT_MOVE | PA_STREAM_PEAK_DETECT | PA_STREAM_ADJUST_LATENCY);
-	pa_buffer_attr bufattr = {.maxlength = 128, .fragsize = sizeof(float)};
-	int err = pa_stream_connect_record(stream, device == PA_INVALID_INDEX ? NULL : devname, &bufattr, flags);
-	if (err != 0) {
-		pa_stream_unref(stream);
-		return NULL;
+	if (atomic_load(&mon->shown) == atomic_load(&app.frame)) {
+		atomic_store(&app.new_peaks, true);
+		app_signal(&app);
 	}
-
-	return stream;
 }
 
-static int find_entry_with_index(uint32_t index, entry_type type) {
-	for (int i = 0; i < (int)app.entries.len; i++) {
-		Entry ent = app.entries.items[i];
-		if (ent.pa_index == index && ent.type == type)
-			return i;
+// copy the active state of the monitors into their entries and flag the entries that changed for reordering
+// caller should hold app-mutex
+static void sync_activity(App *app) {
+	for (size_t t = 0; t <= ENTRY_SOURCE; t++) {
+		Entries *ents = &app->entries[t];
+		for (size_t i = 0; i < ents->len; i++) {
+			Entry *ent = &ents->items[i];
+			bool active = ent->monitor != NULL && atomic_load(&ent->monitor->active);
+			if (ent->active == active)
+				continue;
+			ent->active = active;
+			ent->reorder = true;
+			ents->reorder = true;
+		}
 	}
-	return -1;
 }
 
 uint32_t pa_entry_index(const void *info, entry_type type) {
@@ -285,329 +305,590 @@ uint32_t pa_entry_monitor_index(const void *info, entry_type type) {
 	}
 }
 
-void apply_entry_data(union EntryData *data, const void *info, entry_type type) {
+uint32_t pa_entry_device_index(const void *info, entry_type type) {
+	switch (type) {
+	case ENTRY_SINKINPUT:
+		return ((const pa_sink_input_info *)info)->sink;
+	case ENTRY_SOURCEOUTPUT:
+		return ((const pa_source_output_info *)info)->source;
+	default:
+		return PA_INVALID_INDEX;
+	}
+}
+
+static void name_descs_clear(NameDescs *descs) {
+	for (size_t i = 0; i < descs->len; i++) {
+		intern_release(descs->items[i].name);
+		intern_release(descs->items[i].description);
+	}
+	descs->len = 0;
+}
+
+// Replace the NameDescs `descs` with the `n` port or profile infos in `infos`, unless the server sent the same set
+// again, which is the common case for an update of the active one or the volume.  Sets `changed` if they were replaced.
+#define NAME_DESCS_UPDATE(descs, infos, n, changed)                                                         \
+	do {                                                                                                \
+		bool same = (descs)->len == (n);                                                                \
+		for (size_t j = 0; same && j < (n); j++) {                                                      \
+			same = strcmp((descs)->items[j].name, (infos)[j]->name) == 0 &&                             \
+			       strcmp((descs)->items[j].description, (infos)[j]->description) == 0;                 \
+		}                                                                                               \
+		if (same)                                                                                       \
+			break;                                                                                      \
+		(changed) = true;                                                                               \
+		name_descs_clear(descs);                                                                        \
+		for (size_t j = 0; j < (n); j++) {                                                              \
+			NameDesc desc = {                                                                           \
+				.name = intern((infos)[j]->name),                                                       \
+				.description = intern((infos)[j]->description),                                         \
+				.width = text_width((infos)[j]->description),                                           \
+			};                                                                                          \
+			da_append(descs, desc);                                                                     \
+		}                                                                                               \
+	} while (0)
+
+// returns whether the shown data changed
+static bool apply_entry_data(union EntryData *data, const void *info, entry_type type) {
+	bool changed = false;
+	NameDescs *descs;
+	int current = -1;
 	switch (type) {
 	case ENTRY_SINKINPUT:
 	case ENTRY_SOURCEOUTPUT: {
-		uint32_t device = type == ENTRY_SINKINPUT
-							  ? ((const pa_sink_input_info *)info)->sink
-							  : ((const pa_source_output_info *)info)->source;
-		if (data->device.index != device) {
-			data->device.index = device;
-			if (data->device.name != NULL) {
-				free((void *)data->device.name);
-				data->device.name = NULL;
-			}
-		}
-		break;
+		changed = data->device.index != pa_entry_device_index(info, type);
+		data->device.index = pa_entry_device_index(info, type);
+		return changed;
 	}
 	case ENTRY_SINK: {
-		data->ports.current = -1;
-		for (size_t i = 0; i < data->ports.len; i++) {
-			free((void *)data->ports.items[i].name);
-			free((void *)data->ports.items[i].description);
-		}
-		data->ports.len = 0;
 		const pa_sink_info *si = ((const pa_sink_info *)info);
+		descs = &data->ports;
+		NAME_DESCS_UPDATE(descs, si->ports, si->n_ports, changed);
 		for (uint32_t i = 0; i < si->n_ports; i++) {
-			NameDesc port = {
-				.name = strdup(si->ports[i]->name),
-				.description = strdup(si->ports[i]->description),
-			};
-			da_append(&data->ports, port);
 			if (si->active_port == si->ports[i])
-				data->ports.current = i;
+				current = i;
 		}
 		break;
 	}
 	case ENTRY_SOURCE: {
-		data->ports.current = -1;
-		for (size_t i = 0; i < data->ports.len; i++) {
-			free((void *)data->ports.items[i].name);
-			free((void *)data->ports.items[i].description);
-		}
-		data->ports.len = 0;
 		const pa_source_info *si = ((const pa_source_info *)info);
+		descs = &data->ports;
+		NAME_DESCS_UPDATE(descs, si->ports, si->n_ports, changed);
 		for (uint32_t i = 0; i < si->n_ports; i++) {
-			NameDesc port = {
-				.name = strdup(si->ports[i]->name),
-				.description = strdup(si->ports[i]->description),
-			};
-			da_append(&data->ports, port);
 			if (si->active_port == si->ports[i])
-				data->ports.current = i;
+				current = i;
 		}
 		break;
 	}
 	case ENTRY_CARD: {
-		data->profiles.current = -1;
-		for (size_t i = 0; i < data->profiles.len; i++) {
-			free((void *)data->profiles.items[i].name);
-			free((void *)data->profiles.items[i].description);
-		}
-		data->profiles.len = 0;
 		const pa_card_info *si = ((const pa_card_info *)info);
+		descs = &data->profiles;
+		NAME_DESCS_UPDATE(descs, si->profiles2, si->n_profiles, changed);
 		for (uint32_t i = 0; i < si->n_profiles; i++) {
-			NameDesc profile = {
-				.name = strdup(si->profiles2[i]->name),
-				.description = strdup(si->profiles2[i]->description),
-			};
-			da_append(&data->profiles, profile);
 			if (si->active_profile2 == si->profiles2[i])
-				data->ports.current = i;
+				current = i;
 		}
 		break;
 	}
 	default:
 		__builtin_unreachable();
 	}
+	changed |= descs->current != current;
+	descs->current = current;
+	return changed;
 }
 
-void app_entry_info(const void *info, entry_type type) {
+// returns whether the description of `index` changed
+static bool device_names_set(DeviceNames *names, uint32_t index, const char *description) {
+	for (size_t i = 0; i < names->len; i++) {
+		if (names->items[i].index != index)
+			continue;
+		return label_set(&names->items[i].description, description);
+	}
+	DeviceName name = {.index = index};
+	label_set(&name.description, description);
+	da_append(names, name);
+	return true;
+}
+
+// repaint the name rows of the streams connected to a device whose description changed
+// caller should hold app-mutex
+static void device_name_changed(App *app, entry_type type, uint32_t device) {
+	Entries *ents = &app->entries[type];
+	for (size_t i = 0; i < ents->len; i++) {
+		if (ents->items[i].detail->data.device.index == device)
+			app_entry_dirty(app, &ents->items[i], ROW_NAME);
+	}
+}
+
+static bool device_names_remove(DeviceNames *names, uint32_t index) {
+	for (size_t i = 0; i < names->len; i++) {
+		if (names->items[i].index != index)
+			continue;
+		label_free(&names->items[i].description);
+		memmove(names->items + i, names->items + i + 1, (names->len - i - 1) * sizeof(*names->items));
+		names->len--;
+		return true;
+	}
+	return false;
+}
+
+static void device_names_clear(DeviceNames *names) {
+	for (size_t i = 0; i < names->len; i++)
+		label_free(&names->items[i].description);
+	names->len = 0;
+}
+
+// description of the sink or source a stream entry of `type` is connected to
+// caller should hold app-mutex
+const Label *app_device_name(const App *app, entry_type type, uint32_t device) {
+	const DeviceNames *names = type == ENTRY_SINKINPUT ? &app->sink_names : &app->source_names;
+	for (size_t i = 0; i < names->len; i++) {
+		if (names->items[i].index == device)
+			return &names->items[i].description;
+	}
+	return NULL;
+}
+
+// Take the shown properties from the proplist of `info`, the proplist itself isn't kept.  Returns whether they
+// changed, `reorder` is set if the application did.
+static bool entry_apply_props(Entry *entry, const void *info, entry_type type, bool *reorder) {
+	pa_proplist *props = pa_entry_proplist(info, type);
+	const char *appname = pa_proplist_gets(props, PA_PROP_APPLICATION_NAME);
+	const char *description = pa_proplist_gets(props, PA_PROP_DEVICE_DESCRIPTION);
+	bool changed = false;
+	switch (type) {
+	case ENTRY_SINKINPUT:
+		changed |= label_set(&entry->detail->title, appname);
+		changed |= label_set(&entry->detail->subtitle, entry->name);
+		break;
+	case ENTRY_SOURCEOUTPUT:
+		changed |= label_set(&entry->detail->title, entry->name);
+		changed |= label_set(&entry->detail->subtitle, entry->name);
+		break;
+	case ENTRY_SINK:
+	case ENTRY_SOURCE: {
+		const char *profile = pa_proplist_gets(props, PA_PROP_DEVICE_PROFILE_DESCRIPTION);
+		char buf[512];
+		snprintf(buf, sizeof(buf), "%s%s%s", description != NULL ? description : "", profile != NULL ? " " : "",
+		         profile != NULL ? profile : "");
+		changed |= label_set(&entry->detail->title, buf);
+		break;
+	}
+	case ENTRY_CARD:
+		changed |= label_set(&entry->detail->title, description);
+		break;
+	}
+
+	if (appname == NULL)
+		appname = entry->name;
+	if (entry->application != NULL && strcmp(entry->application, appname) == 0)
+		return changed;
+	free(entry->application);
+	entry->application = strdup(appname);
+	*reorder = true;
+	return true;
+}
+
+// returns whether the cache changed, an update repeating the cached state repaints nothing
+bool app_entry_info(const void *info, entry_type type) {
 	uint32_t index = pa_entry_index(info, type);
 	const char *name = pa_entry_name(info, type);
 	assert(info != NULL);
 	pthread_mutex_lock(&app.mutex);
-	int i = find_entry_with_index(index, type);
+	Entries *ents = &app.entries[type];
+	int i = entries_find(ents, type, index);
+	bool changed = true;
 	if (i != -1) {
-		Entry *entry = &app.entries.items[i];
+		Entry *entry = &ents->items[i];
 		assert(entry->type == type);
+		bool reorder = entry->corked != pa_entry_corked(info, type);
+		if (type == ENTRY_SINKINPUT || type == ENTRY_SOURCEOUTPUT)
+			reorder |= entry->detail->data.device.index != pa_entry_device_index(info, type);
 		if(strcmp(entry->name, name) != 0) {
-			free((void*)entry->name);
-			entry->name = strdup(name);
+			intern_release(entry->name);
+			entry->name = intern(name);
+			reorder = true;
+		}
+		changed = entry_apply_props(entry, info, type, &reorder) | reorder;
+		pa_cvolume volume = pa_entry_volume(info, type);
+		pa_channel_map channel_map = pa_entry_channel_map(info, type);
+		// the local volume is newer than what the server reports until our own changes went through
+		bool take_volume = entry->pending_volume == 0 && !entry->volume_dirty;
+		if (take_volume)
+			changed |= !pa_cvolume_equal(&entry->detail->volume, &volume);
+		changed |= !pa_channel_map_equal(&entry->detail->channel_map, &channel_map);
+		changed |= entry->muted != pa_entry_mute(info, type);
+		changed |= entry->monitor_index != pa_entry_monitor_index(info, type);
+		changed |= apply_entry_data(&entry->detail->data, info, type);
+
+		// reorders and a changed channel count repaint the whole page, anything else only the rows of the entry
+		if (reorder) {
+			entry->reorder = true;
+			ents->reorder = true;
+		} else if (entry->channels != volume.channels) {
+			if (type == app.entry_page)
+				atomic_store(&app.should_redraw, true);
+		} else if (changed) {
+			app_entry_dirty(&app, entry, ROW_VOLUME | ROW_NAME | (pa_entry_corked(info, type) ? ROW_METER : 0));
 		}
 		entry->marked = false;
-		entry->volume = pa_entry_volume(info, type);
+		if (take_volume) {
+			entry->detail->volume = volume;
+			if (entry->channels != volume.channels) {
+				entry->channels = volume.channels;
+				entries_lines_changed(ents, i);
+			}
+		}
 		entry->corked = pa_entry_corked(info, type);
-		entry->channel_map = pa_entry_channel_map(info, type);
+		entry->detail->channel_map = channel_map;
 		entry->muted = pa_entry_mute(info, type);
 		entry->monitor_index = pa_entry_monitor_index(info, type);
-		if (entry->props != NULL) {
-			pa_proplist_free(entry->props);
+		// Shared monitors are never reset for a single entry.  A corked stream just drops its reference, it is
+		// acquired again once the stream plays.  Corked entries hide their meter, which repaints on the reorder.
+		if (entry->corked && entry->monitor != NULL && (type == ENTRY_SINKINPUT || type == ENTRY_SOURCEOUTPUT)) {
+			monitor_release(entry->monitor);
+			entry->monitor = NULL;
+			entry->active = false;
 		}
-		if (pa_entry_corked(info, type))
-			entry->peak = 0;
-		entry->props = pa_proplist_copy(pa_entry_proplist(info, type));
-		apply_entry_data(&entry->data, info, type);
 	} else {
+		EntryDetail *detail = calloc(1, sizeof(*detail));
+		assert(detail != NULL);
+		detail->volume = pa_entry_volume(info, type);
+		detail->channel_map = pa_entry_channel_map(info, type);
 		Entry ent = {
 			.type = type,
-			.name = strdup(name),
+			.name = intern(name),
 			.pa_index = index,
-			.volume = pa_entry_volume(info, type),
-			.channel_map = pa_entry_channel_map(info, type),
-			.props = pa_proplist_copy(pa_entry_proplist(info, type)),
+			.channels = detail->volume.channels,
+			.detail = detail,
 			.monitor_index = pa_entry_monitor_index(info, type),
 			.muted = pa_entry_mute(info, type),
 			.corked = pa_entry_corked(info, type),
 			.volume_lock = type != ENTRY_CARD,
+			.reorder = true,
 		};
-		apply_entry_data(&ent.data, info, type);
-		da_append(&app.entries, ent);
+		ents->reorder = true;
+		bool reorder;
+		entry_apply_props(&ent, info, type, &reorder);
+		apply_entry_data(&detail->data, info, type);
+		entries_append(ents, ent);
 	}
 	pthread_mutex_unlock(&app.mutex);
+	return changed;
 }
+// queries for a single object pass the flag to raise once the entry was updated, list queries pass NULL
+static void info_query_done(void *data) {
+	if (data != NULL)
+		atomic_store((atomic_bool *)data, true);
+	app_signal(&app);
+}
+
+// count the outcome of a single-object query in `EventStats`, the replies to list queries aren't events
+static void count_update(void *data, bool changed) {
+	if (data != NULL && !changed)
+		atomic_fetch_add(&app.events.unchanged, 1);
+}
+
 void app_sink_input_info(pa_context *ctx, const pa_sink_input_info *info, int eol, void *data) {
 	(void)ctx;
-	(void)data;
 	if (info == NULL) {
 		if (eol)
-			pa_threaded_mainloop_signal(app.pa_mainloop, false);
+			info_query_done(data);
 		return;
 	}
-	app_entry_info(info, ENTRY_SINKINPUT);
+	count_update(data, app_entry_info(info, ENTRY_SINKINPUT));
 }
 void app_source_output_info(pa_context *ctx, const pa_source_output_info *info, int eol, void *data) {
 	(void)ctx;
-	(void)data;
 	if (info == NULL) {
 		if (eol)
-			pa_threaded_mainloop_signal(app.pa_mainloop, false);
+			info_query_done(data);
 		return;
 	}
 	// hide peak-detection streams
 	const char *appname = pa_proplist_gets(info->proplist, PA_PROP_APPLICATION_ID);
 	if (appname != NULL && strcmp(appname, "org.PulseAudio.pavucontrol") == 0) {
+		if (data != NULL)
+			atomic_fetch_add(&app.events.ignored, 1);
 		return;
 	}
-	app_entry_info(info, ENTRY_SOURCEOUTPUT);
+	count_update(data, app_entry_info(info, ENTRY_SOURCEOUTPUT));
 }
 
 void app_sink_info(pa_context *ctx, const pa_sink_info *info, int eol, void *data) {
 	(void)ctx;
-	(void)data;
 	if (info == NULL) {
 		if (eol)
-			pa_threaded_mainloop_signal(app.pa_mainloop, false);
+			info_query_done(data);
 		return;
 	}
-	app_entry_info(info, ENTRY_SINK);
+	pthread_mutex_lock(&app.mutex);
+	bool changed = device_names_set(&app.sink_names, info->index, info->description);
+	if (changed)
+		device_name_changed(&app, ENTRY_SINKINPUT, info->index);
+	pthread_mutex_unlock(&app.mutex);
+	changed |= app_entry_info(info, ENTRY_SINK);
+	count_update(data, changed);
 }
 
 void app_source_info(pa_context *ctx, const pa_source_info *info, int eol, void *data) {
 	(void)ctx;
-	(void)data;
 	if (info == NULL) {
 		if (eol)
-			pa_threaded_mainloop_signal(app.pa_mainloop, false);
+			info_query_done(data);
 		return;
 	}
-	// hide monitors
+	pthread_mutex_lock(&app.mutex);
+	bool changed = device_names_set(&app.source_names, info->index, info->description);
+	if (changed)
+		device_name_changed(&app, ENTRY_SOURCEOUTPUT, info->index);
+	pthread_mutex_unlock(&app.mutex);
+	// hide monitors, only their name is shown by the streams recording from them
 	const char *devtyp = pa_proplist_gets(info->proplist, PA_PROP_DEVICE_CLASS);
 	if(devtyp != NULL && strcmp(devtyp, "monitor") == 0) {
+		count_update(data, changed);
 		return;
 	}
-	app_entry_info(info, ENTRY_SOURCE);
+	changed |= app_entry_info(info, ENTRY_SOURCE);
+	count_update(data, changed);
 }
 
 void app_card_info(pa_context *ctx, const pa_card_info *info, int eol, void *data) {
 	(void)ctx;
-	(void)data;
 	if (info == NULL) {
 		if (eol)
-			pa_threaded_mainloop_signal(app.pa_mainloop, false);
+			info_query_done(data);
 		return;
 	}
-	app_entry_info(info, ENTRY_CARD);
+	count_update(data, app_entry_info(info, ENTRY_CARD));
 }
 
-static void app_sink_info_name(pa_context *ctx, const pa_sink_info *i, int eol, void *userdata) {
-	(void)ctx;
-	if (eol) {
-		assert(i == NULL);
-		pa_threaded_mainloop_signal(app.pa_mainloop, false);
-		return;
-	}
-	Entry *ent = userdata;
-	ent->data.device.name = strdup(i->description);
-}
-static void app_source_info_name(pa_context *ctx, const pa_source_info *i, int eol, void *userdata) {
-	(void)ctx;
-	if (eol) {
-		assert(i == NULL);
-		pa_threaded_mainloop_signal(app.pa_mainloop, false);
-		return;
-	}
-	Entry *ent = userdata;
-	ent->data.device.name = strdup(i->description);
-}
-
-bool app_refresh_entries(App *app) {
-	pa_threaded_mainloop_lock(app->pa_mainloop);
+static bool app_remove_entry(App *app, entry_type type, uint32_t index) {
 	pthread_mutex_lock(&app->mutex);
-	if (app->pa_context == NULL || pa_context_get_state(app->pa_context) != PA_CONTEXT_READY) {
-		pthread_mutex_unlock(&app->mutex);
-		pa_threaded_mainloop_unlock(app->pa_mainloop);
-		return false;
+	Entries *ents = &app->entries[type];
+	int i = entries_find(ents, type, index);
+	if (i != -1) {
+		entry_free(&ents->items[i]);
+		entries_remove(ents, i);
+		if (type == app->entry_page) {
+			atomic_store(&app->should_redraw, true);
+			clamp_selection(app);
+		}
 	}
+	pthread_mutex_unlock(&app->mutex);
+	return i != -1;
+}
 
-	for (size_t i = 0; i < app->entries.len; i++)
-		app->entries.items[i].marked = true;
-
+// update a single entry from the server without waiting for it, should_refresh is raised once it arrived
+// caller should hold mainloop
+void app_fetch_entry(App *app, entry_type type, uint32_t index) {
 	pa_operation *op;
-	pa_operation_state_t state;
-
-	switch (app->entry_page) {
+	switch (type) {
 	case ENTRY_SINKINPUT:
-		op = pa_context_get_sink_input_info_list(app->pa_context, &app_sink_input_info, NULL);
+		op = pa_context_get_sink_input_info(app->pa_context, index, &app_sink_input_info, &app->should_refresh);
 		break;
 	case ENTRY_SOURCEOUTPUT:
-		op = pa_context_get_source_output_info_list(app->pa_context, &app_source_output_info, NULL);
+		op = pa_context_get_source_output_info(app->pa_context, index, &app_source_output_info, &app->should_refresh);
 		break;
 	case ENTRY_SINK:
-		op = pa_context_get_sink_info_list(app->pa_context, &app_sink_info, NULL);
+		op = pa_context_get_sink_info_by_index(app->pa_context, index, &app_sink_info, &app->should_refresh);
 		break;
 	case ENTRY_SOURCE:
-		op = pa_context_get_source_info_list(app->pa_context, &app_source_info, NULL);
+		op = pa_context_get_source_info_by_index(app->pa_context, index, &app_source_info, &app->should_refresh);
 		break;
 	case ENTRY_CARD:
-		op = pa_context_get_card_info_list(app->pa_context, &app_card_info, NULL);
+		op = pa_context_get_card_info_by_index(app->pa_context, index, &app_card_info, &app->should_refresh);
 		break;
 	default:
 		__builtin_unreachable();
 	}
-	assert(op != NULL);
+	if (op != NULL)
+		pa_operation_unref(op);
+}
+
+// called from the subscription callback on the mainloop thread.  Only the object named by the event is fetched or
+// dropped, this keeps the caches of all tabs current, including the sink and source names the stream tabs show.
+void app_handle_event(App *app, pa_subscription_event_type_t evt, uint32_t index) {
+	atomic_fetch_add(&app->events.received, 1);
+	entry_type type;
+	switch (evt & PA_SUBSCRIPTION_EVENT_FACILITY_MASK) {
+	case PA_SUBSCRIPTION_EVENT_SINK_INPUT:
+		type = ENTRY_SINKINPUT;
+		break;
+	case PA_SUBSCRIPTION_EVENT_SOURCE_OUTPUT:
+		type = ENTRY_SOURCEOUTPUT;
+		break;
+	case PA_SUBSCRIPTION_EVENT_SINK:
+		type = ENTRY_SINK;
+		break;
+	case PA_SUBSCRIPTION_EVENT_SOURCE:
+		type = ENTRY_SOURCE;
+		break;
+	case PA_SUBSCRIPTION_EVENT_CARD:
+		type = ENTRY_CARD;
+		break;
+	default:
+		atomic_fetch_add(&app->events.ignored, 1);
+		return;
+	}
+
+	if ((evt & PA_SUBSCRIPTION_EVENT_TYPE_MASK) == PA_SUBSCRIPTION_EVENT_REMOVE) {
+		bool removed = app_remove_entry(app, type, index);
+		pthread_mutex_lock(&app->mutex);
+		if (type == ENTRY_SINK)
+			removed |= device_names_remove(&app->sink_names, index);
+		else if (type == ENTRY_SOURCE)
+			removed |= device_names_remove(&app->source_names, index);
+		pthread_mutex_unlock(&app->mutex);
+		// the peak-detection streams were never cached
+		if (!removed) {
+			atomic_fetch_add(&app->events.ignored, 1);
+			return;
+		}
+		atomic_store(&app->should_refresh, true);
+		app_signal(app);
+		return;
+	}
+
+	app_fetch_entry(app, type, index);
+}
+
+// replace the entries of all tabs with the full lists, the queries are issued together and waited for at once
+// caller should hold mainloop and app-mutex, on failure only the mainloop is held
+static bool resync_entries(App *app) {
+	for (size_t t = 0; t <= ENTRY_CARD; t++) {
+		for (size_t i = 0; i < app->entries[t].len; i++)
+			app->entries[t].items[i].marked = true;
+	}
+	device_names_clear(&app->sink_names);
+	device_names_clear(&app->source_names);
 
+	pa_operation *ops[] = {
+		pa_context_get_sink_input_info_list(app->pa_context, &app_sink_input_info, NULL),
+		pa_context_get_source_output_info_list(app->pa_context, &app_source_output_info, NULL),
+		pa_context_get_sink_info_list(app->pa_context, &app_sink_info, NULL),
+		pa_context_get_source_info_list(app->pa_context, &app_source_info, NULL),
+		pa_context_get_card_info_list(app->pa_context, &app_card_info, NULL),
+	};
+	size_t n_ops = sizeof(ops) / sizeof(*ops);
+	for (size_t i = 0; i < n_ops; i++)
+		assert(ops[i] != NULL);
+
+	bool cancelled = false;
 	pthread_mutex_unlock(&app->mutex);
-	while ((state = pa_operation_get_state(op)) == PA_OPERATION_RUNNING) {
-		pa_threaded_mainloop_wait(app->pa_mainloop);
+	for (size_t i = 0; i < n_ops; i++) {
+		pa_operation_state_t state;
+		while ((state = pa_operation_get_state(ops[i])) == PA_OPERATION_RUNNING) {
+			app_wait(app);
+		}
+		pa_operation_unref(ops[i]);
+		cancelled |= state == PA_OPERATION_CANCELLED;
 	}
-	pa_operation_unref(op);
-	if(state == PA_OPERATION_CANCELLED) {
-		pa_threaded_mainloop_unlock(app->pa_mainloop);
+	if (cancelled)
 		return false;
-	}
 	pthread_mutex_lock(&app->mutex);
-	assert(state == PA_OPERATION_DONE);
-
-	cull_entries(&app->entries);
-
-	uint32_t indexbuf[app->entries.len];
-	for(size_t i = 0; i < app->entries.len; i++)
-		indexbuf[i] = app->entries.items[i].pa_index;
-	struct entry_indices indices = {.count = (int)app->entries.len, .indices = indexbuf};
-	cmp_entry_indices = &indices;
-	qsort(app->entries.items, app->entries.len, sizeof(*app->entries.items), cmp_entry);
-
-	for (size_t i = 0; i < app->entries.len; i++) {
-		Entry *ent = &app->entries.items[i];
-		// populate device name
-		if ((ent->type == ENTRY_SINKINPUT || ent->type == ENTRY_SOURCEOUTPUT) && ent->data.device.name == NULL) {
-			pa_operation *op;
-			switch (ent->type) {
-			case ENTRY_SINKINPUT:
-				op = pa_context_get_sink_info_by_index(app->pa_context, ent->data.device.index, &app_sink_info_name, ent);
-				break;
-			case ENTRY_SOURCEOUTPUT:
-				op = pa_context_get_source_info_by_index(app->pa_context, ent->data.device.index, &app_source_info_name, ent);
-				break;
-			default:
-				__builtin_unreachable();
-			}
-			assert(op != NULL);
-			pa_operation_state_t state;
-			pthread_mutex_unlock(&app->mutex);
-			while ((state = pa_operation_get_state(op)) == PA_OPERATION_RUNNING) {
-				pa_threaded_mainloop_wait(app->pa_mainloop);
-			}
-			pa_operation_unref(op);
-			if(state == PA_OPERATION_CANCELLED) {
-				pa_threaded_mainloop_unlock(app->pa_mainloop);
-				return false;
-			}
-			pthread_mutex_lock(&app->mutex);
-			assert(state == PA_OPERATION_DONE);
-			assert(ent->data.device.name != NULL);
-		}
 
-		// ensure monitor stream exists
-		if (ent->monitor_stream != NULL || ent->type == ENTRY_CARD)
+	for (size_t t = 0; t <= ENTRY_CARD; t++)
+		cull_entries(&app->entries[t]);
+	clamp_selection(app);
+	atomic_store(&app->should_redraw, true);
+	return true;
+}
+
+// the monitor an entry should show, returns false for entries without a peak meter
+static bool entry_monitor_key(const Entry *ent, monitor_kind *kind, uint32_t *index) {
+	switch (ent->type) {
+	case ENTRY_SINKINPUT:
+		*kind = MONITOR_SINKINPUT;
+		*index = ent->pa_index;
+		return true;
+	case ENTRY_SOURCEOUTPUT:
+	case ENTRY_SINK:
+	case ENTRY_SOURCE:
+		*kind = MONITOR_SOURCE;
+		*index = ent->monitor_index;
+		return *index != PA_INVALID_INDEX;
+	default:
+		return false;
+	}
+}
+
+// Acquire the monitor each entry should show.  Entries whose source changed switch monitors, failed monitors are
+// reconnected by acquiring them again.  Returns whether any entry got a new monitor.
+// caller should hold mainloop and app-mutex
+static bool ensure_monitors(App *app, Entries *ents) {
+	bool acquired = false;
+	for (size_t i = 0; i < ents->len; i++) {
+		Entry *ent = &ents->items[i];
+		monitor_kind kind;
+		uint32_t index;
+		// corked streams are left out, their monitors would be stuck in creating state until they uncork
+		if (!entry_monitor_key(ent, &kind, &index) || (ent->corked && ent->type != ENTRY_SINK && ent->type != ENTRY_SOURCE))
+			continue;
+		// a changed channel map needs a stream of its own
+		const pa_channel_map *map = app->channel_meters ? &ent->detail->channel_map : NULL;
+		if (ent->monitor != NULL && monitor_matches(ent->monitor, kind, index, map) && ent->monitor->stream != NULL)
 			continue;
-		// we exclude corked entries, because those monitor streams will be stuck in creating state, which can't be
-		// disconnected yet, so it just accumulates dead streams when switching tabs
-		if (ent->type == ENTRY_SINKINPUT && !ent->corked) {
-			ent->monitor_stream = create_monitor(app->pa_context, ent->pa_index, PA_INVALID_INDEX);
+
+		Monitor *old = ent->monitor;
+		ent->monitor = monitor_acquire(app->pa_context, kind, index, map);
+		ent->active = atomic_load(&ent->monitor->active);
+		if (old != NULL)
+			monitor_release(old);
+		acquired = true;
+		if (app->sort_key == SORT_PEAK) {
+			ent->reorder = true;
+			ents->reorder = true;
 		}
-		if (ent->type == ENTRY_SOURCEOUTPUT && !ent->corked) {
-			const char *appname = pa_proplist_gets(ent->props, PA_PROP_APPLICATION_ID);
-			if (appname == NULL || strcmp(appname, "org.PulseAudio.pavucontrol") != 0) {
-				ent->monitor_stream = create_monitor(app->pa_context, PA_INVALID_INDEX, ent->monitor_index);
-			}
+	}
+	return acquired;
+}
+
+bool app_refresh_entries(App *app) {
+	app_lock(app);
+	pthread_mutex_lock(&app->mutex);
+	if (app->pa_context == NULL || pa_context_get_state(app->pa_context) != PA_CONTEXT_READY) {
+		pthread_mutex_unlock(&app->mutex);
+		app_unlock(app);
+		return false;
+	}
+
+	// only pull the whole lists on reconnect or when asked to, everything else arrives as single-object updates from
+	// `app_handle_event`
+	if (atomic_exchange(&app->should_resync, false)) {
+		if (!resync_entries(app)) {
+			app_unlock(app);
+			return false;
 		}
-		if ((ent->type == ENTRY_SINK || ent->type == ENTRY_SOURCE)) {
-			ent->monitor_stream = create_monitor(app->pa_context, PA_INVALID_INDEX, ent->monitor_index);
+		app->synced = true;
+		// drop the waiting notice shown over the snapshot
+		if (app->provisional) {
+			app->provisional = false;
+			app->status[0] = '\0';
 		}
 	}
+	if (atomic_exchange(&app->activity_changed, false))
+		sync_activity(app);
+	// monitors of hidden tabs stay connected, so their meters are current as soon as the tab is shown
+	for (size_t t = 0; t <= ENTRY_CARD; t++) {
+		bool reordered = order_entries(app, &app->entries[t]);
+		bool acquired = ensure_monitors(app, &app->entries[t]);
+		// new monitors are registered with the renderer by a full paint
+		if ((reordered || acquired) && t == app->entry_page)
+			atomic_store(&app->should_redraw, true);
+	}
 
 	pthread_mutex_unlock(&app->mutex);
-	pa_threaded_mainloop_unlock(app->pa_mainloop);
+	app_unlock(app);
 	return true;
 }
-void app_init(App *app, pa_context *context, pa_threaded_mainloop *mainloop) {
+void app_init(App *app, pa_context *context, pa_threaded_mainloop *mainloop, pa_mainloop *loop) {
+	assert((mainloop == NULL) != (loop == NULL));
 	app->pa_context = context;
 	app->pa_mainloop = mainloop;
+	app->pa_loop = loop;
 	app->entry_page = ENTRY_SINKINPUT;
-	app->running = true;
+	atomic_store(&app->running, true);
 	app->resized = ATOMIC_VAR_INIT(false);
 	int err = pthread_mutex_init(&app->mutex, NULL);
 	if(err != 0) {
@@ -616,44 +897,164 @@ void app_init(App *app, pa_context *context, pa_threaded_mainloop *mainloop) {
 	}
 }
 
+// The context and its callbacks run either on the thread of `pa_mainloop`, or on the main thread, which runs `pa_loop`
+// from `app_wait` only.  Without the second thread there is nothing to lock and nobody to wake up, `app_signal` just
+// ends the wait once the callback returns.
+void app_lock(App *app) {
+	if (app->pa_mainloop != NULL)
+		pa_threaded_mainloop_lock(app->pa_mainloop);
+}
+
+void app_unlock(App *app) {
+	if (app->pa_mainloop != NULL)
+		pa_threaded_mainloop_unlock(app->pa_mainloop);
+}
+
+// wait for a callback to call `app_signal`
+// caller should hold mainloop, but not app-mutex
+void app_wait(App *app) {
+	if (app->pa_mainloop != NULL) {
+		pa_threaded_mainloop_wait(app->pa_mainloop);
+		return;
+	}
+	app->signalled = false;
+	while (!app->signalled) {
+		if (pa_mainloop_iterate(app->pa_loop, 1, NULL) < 0)
+			return;
+	}
+}
+
+void app_signal(App *app) {
+	if (app->pa_mainloop != NULL)
+		pa_threaded_mainloop_signal(app->pa_mainloop, false);
+	else
+		app->signalled = true;
+}
+
+pa_mainloop_api *app_api(App *app) {
+	if (app->pa_mainloop != NULL)
+		return pa_threaded_mainloop_get_api(app->pa_mainloop);
+	return pa_mainloop_get_api(app->pa_loop);
+}
+
+void app_command_done(pa_context *ctx, int success, void *data) {
+	(void)ctx;
+	Command *cmd = data;
+	cmd->success = success;
+	app_signal(&app);
+}
+
+Command *app_command_new(const Entry *ent, const char *what, bool volume) {
+	Command *cmd = calloc(1, sizeof(*cmd));
+	assert(cmd != NULL);
+	cmd->type = ent->type;
+	cmd->index = ent->pa_index;
+	cmd->what = what;
+	cmd->volume = volume;
+	return cmd;
+}
+
+static void command_failed(App *app, Command *cmd) {
+	snprintf(app->status, sizeof(app->status), "failed to %s: %s", cmd->what, pa_strerror(pa_context_errno(app->pa_context)));
+	atomic_store(&app->should_update, true);
+}
+
+// Track `op`, which was issued with `app_command_done` and `cmd` as callback.  The caller applies the expected result
+// to its entry right away, failures are reported and undone by refetching the entry in `app_reap_commands`.
+// caller should hold mainloop and app-mutex
+void app_command_start(App *app, Command *cmd, pa_operation *op) {
+	if (op == NULL) {
+		command_failed(app, cmd);
+		free(cmd);
+		return;
+	}
+	cmd->op = op;
+	if (cmd->volume) {
+		Entries *ents = &app->entries[cmd->type];
+		int i = entries_find(ents, cmd->type, cmd->index);
+		if (i != -1)
+			ents->items[i].pending_volume++;
+	}
+	da_append(&app->commands, cmd);
+}
+
+// caller should hold mainloop and app-mutex
+void app_reap_commands(App *app) {
+	size_t kept = 0;
+	for (size_t i = 0; i < app->commands.len; i++) {
+		Command *cmd = app->commands.items[i];
+		pa_operation_state_t state = pa_operation_get_state(cmd->op);
+		if (state == PA_OPERATION_RUNNING) {
+			app->commands.items[kept++] = cmd;
+			continue;
+		}
+		Entries *ents = &app->entries[cmd->type];
+		int pos = entries_find(ents, cmd->type, cmd->index);
+		if (pos != -1 && cmd->volume && ents->items[pos].pending_volume > 0)
+			ents->items[pos].pending_volume--;
+		// cancelled operations belong to a lost connection, the reconnect resyncs everything
+		if (state == PA_OPERATION_DONE && !cmd->success) {
+			command_failed(app, cmd);
+			if (pos != -1)
+				app_fetch_entry(app, cmd->type, cmd->index);
+		}
+		pa_operation_unref(cmd->op);
+		free(cmd);
+	}
+	app->commands.len = kept;
+}
+
+bool input_queue_push(InputQueue *queue, InputEvent evt) {
+	if (queue->tail - queue->head == INPUT_QUEUE_CAP)
+		return false;
+	queue->items[queue->tail++ % INPUT_QUEUE_CAP] = evt;
+	return true;
+}
+
+bool input_queue_pop(InputQueue *queue, InputEvent *evt) {
+	if (queue->head == queue->tail)
+		return false;
+	*evt = queue->items[queue->head++ % INPUT_QUEUE_CAP];
+	return true;
+}
+
+bool input_queue_empty(InputQueue *queue) {
+	return queue->head == queue->tail;
+}
+
 static void entry_data_free(Entry *entry) {
+	union EntryData *data = &entry->detail->data;
 	switch(entry->type) {
 		case ENTRY_SINKINPUT:
 		case ENTRY_SOURCEOUTPUT:
-			if(entry->data.device.name != NULL)
-				free((void*)entry->data.device.name);
 			break;
 		case ENTRY_SINK:
 		case ENTRY_SOURCE:
 		case ENTRY_CARD:
-			for(size_t i = 0; i < entry->data.ports.len; i++) {
-				free((void*)entry->data.ports.items[i].name);
-				free((void*)entry->data.ports.items[i].description);
-			}
-			entry->data.ports.len = 0;
-			entry->data.ports.current = -1;
-			if(entry->data.ports.items != 0) {
-				free(entry->data.ports.items);
-				entry->data.ports.items = NULL;
-				entry->data.ports.cap = 0;
+			name_descs_clear(&data->ports);
+			data->ports.current = -1;
+			if(data->ports.items != 0) {
+				free(data->ports.items);
+				data->ports.items = NULL;
+				data->ports.cap = 0;
 			}
 			break;
 	}
 }
 void entry_free(Entry *entry) {
-	if(entry->name != NULL) {
-		free((void*)entry->name);
-		entry->name = NULL;
-	}
-	if(entry->props != NULL){
-		pa_proplist_free(entry->props);
-		entry->props = NULL;
-	}
-	entry_data_free(entry);
-	if(entry->monitor_stream != NULL && pa_stream_get_state(entry->monitor_stream) == PA_STREAM_READY){
-		int err = pa_stream_disconnect(entry->monitor_stream);
-		assert(err == 0);
-		pa_stream_unref(entry->monitor_stream);
-		entry->monitor_stream = NULL;
+	intern_release(entry->name);
+	entry->name = NULL;
+	free(entry->application);
+	entry->application = NULL;
+	if(entry->detail != NULL) {
+		label_free(&entry->detail->title);
+		label_free(&entry->detail->subtitle);
+		entry_data_free(entry);
+		free(entry->detail);
+		entry->detail = NULL;
+	}
+	if(entry->monitor != NULL) {
+		monitor_release(entry->monitor);
+		entry->monitor = NULL;
 	}
 }
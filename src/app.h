@@ -6,6 +6,8 @@
 #include <pthread.h>
 #include <pulse/pulseaudio.h>
 #include <stdatomic.h>
+#include "monitor.h"
+#include "label.h"
 
 typedef enum {
 	ENTRY_SINKINPUT,
@@ -15,9 +17,19 @@ typedef enum {
 	ENTRY_CARD
 } entry_type;
 
+typedef enum {
+	SORT_NONE = 0,
+	SORT_NAME,
+	SORT_APPLICATION,
+	SORT_PEAK,
+	SORT_DEVICE,
+} sort_key;
+
 typedef struct {
 	const char *name;
 	const char *description;
+	// of the description in terminal cells
+	int width;
 } NameDesc;
 
 typedef struct {
@@ -28,11 +40,9 @@ typedef struct {
 } NameDescs;
 
 union EntryData {
-	// sink/source of sinkinput and sourceoutput entries
-	// TODO: do we put device names in here?
+	// sink/source of sinkinput and sourceoutput entries, see `app_device_name` for its description
 	struct {
 		uint32_t index;
-		const char *name;
 	} device;
 	// ports of sink and source entries
 	NameDescs ports;
@@ -40,62 +50,258 @@ union EntryData {
 	NameDescs profiles;
 };
 
+// rows of an entry to repaint on the next frame, see `app_entry_dirty`
+enum {
+	ROW_VOLUME = 1 << 0,
+	ROW_METER = 1 << 1,
+	ROW_NAME = 1 << 2,
+};
+
+// the parts of an entry only used to draw, send or update that single entry, see `Entry`
 typedef struct {
-	entry_type type;
-	const char *name;
-	uint32_t pa_index;
 	pa_cvolume volume;
 	pa_channel_map channel_map;
-	pa_proplist *props;
-	pa_stream *monitor_stream;
+	// The few properties shown, taken from the proplist when the entry is updated.  `title` starts the name row, streams
+	// follow it with their dimmed `subtitle`.
+	Label title;
+	Label subtitle;
+	// pa_rtclock_now() of the last set-volume
+	pa_usec_t volume_sent;
+	// the monitor's clip count when the name row was last painted, only used by the renderer
+	unsigned clips_shown;
+	union EntryData data;
+} EntryDetail;
+
+// The fields read by passes over all entries (lookup, ordering, culling, peaks, scrolling) are kept in the entry itself,
+// which fits a cache line.  Volumes, channel map, labels and ports are behind `detail`, owned by the entry and shared
+// by its copies.
+typedef struct {
+	uint32_t pa_index;
 	uint32_t monitor_index;
-	float peak;
+	entry_type type;
+	// of the volume, the number of channel rows
+	uint8_t channels;
+	// ROW_* flags
+	uint8_t dirty;
 	bool muted;
 	bool corked;
 	bool marked;
 	bool volume_lock;
-
-	union EntryData data;
+	// the local volume changed and wasn't sent yet, see `flush_volume_changes`
+	bool volume_dirty;
+	// a value the entry order depends on changed since the last ordering
+	bool reorder;
+	// `Monitor.active` as of the last refresh, so the order only changes on the main thread
+	bool active;
+	// set-volume commands in flight, server updates don't override the local volume meanwhile.  At most one per frame
+	// and entry is sent, so 16 bits keep `Entry` at 56 bytes.
+	uint16_t pending_volume;
+	const char *name;
+	// the key of the application sort
+	char *application;
+	// peak meter, shared with other entries showing the same sink input or source
+	Monitor *monitor;
+	EntryDetail *detail;
 } Entry;
+_Static_assert(sizeof(Entry) <= 64, "Entry should fit a cache line");
+
+typedef struct {
+	// position + 1 of the entry hashed to each slot, 0 for empty slots
+	uint32_t *slots;
+	size_t cap;
+} EntryIndex;
+
+// Fenwick tree over the screen lines of the items, node k (1-based) sums the items (k - lowbit(k), k]
+typedef struct {
+	int *nodes;
+	size_t cap;
+} EntryLines;
 
 typedef struct {
 	Entry *items;
 	size_t len;
 	size_t cap;
+	EntryIndex index;
+	EntryLines lines;
+	// some items have `reorder` set
+	bool reorder;
 } Entries;
 
+typedef struct {
+	uint32_t index;
+	Label description;
+} DeviceName;
+
+typedef struct {
+	DeviceName *items;
+	size_t len;
+	size_t cap;
+} DeviceNames;
+
 typedef struct {
 	int keycode;
 	const char *keyname;
+	// rtclock time the key was read
+	pa_usec_t at;
 } InputEvent;
 
+// a mutating operation issued without waiting for its completion
 typedef struct {
-	InputEvent *items;
+	pa_operation *op;
+	entry_type type;
+	uint32_t index;
+	// what was attempted, for the error message
+	const char *what;
+	bool volume;
+	// written by the completion callback
+	bool success;
+} Command;
+
+typedef struct {
+	Command **items;
 	size_t len;
 	size_t cap;
+} Commands;
+
+#define INPUT_QUEUE_CAP 256
+
+// Fixed-size ring of the keys decoded by `read_keys` and not yet handled by `drain_input_queue`.  Both run on the main
+// thread, so it is neither locked nor atomic, and it never allocates.  `head` and `tail` only grow, their difference
+// is the fill level.
+typedef struct {
+	InputEvent items[INPUT_QUEUE_CAP];
+	// next event to read
+	size_t head;
+	// next slot to write
+	size_t tail;
 } InputQueue;
 
+// subscription events since the start, see `app_handle_event`
+typedef struct {
+	atomic_size_t received;
+	// for objects that aren't shown, like the peak-detection streams
+	atomic_size_t ignored;
+	// the fetched object looked the same as the cached entry, nothing was repainted
+	atomic_size_t unchanged;
+} EventStats;
+
 typedef struct {
 	pa_context *pa_context;
+	// the context runs on exactly one of these, see `app_lock`
 	pa_threaded_mainloop *pa_mainloop;
-	Entries entries;
+	pa_mainloop *pa_loop;
+	// `app_signal` was called since `app_wait` started running `pa_loop`
+	bool signalled;
+	// one cache per tab, all kept current by subscription events, see `app_page`
+	Entries entries[ENTRY_CARD + 1];
+	// descriptions of all sinks and sources, shared by the stream entries
+	DeviceNames sink_names;
+	DeviceNames source_names;
 	entry_type entry_page;
 	int selected_entry;
 	int selected_channel;
 	int scroll;
+	sort_key sort_key;
+	// meter every channel of an entry instead of the downmix
+	bool channel_meters;
 	pthread_mutex_t mutex;
+	// reconcile entries (order, device names, monitors) and repaint
 	atomic_bool should_refresh;
+	// refetch all lists from the server, implies should_refresh
+	atomic_bool should_resync;
+	// repaint from the cached entries only
+	atomic_bool should_redraw;
+	// repaint the header and the `dirty` rows of entries, the layout is unchanged
+	atomic_bool should_update;
 	atomic_bool resized;
 	//bool resized;
-	bool new_peaks;
-	bool running;
+	// a monitor shown in the last paint has a new peak
+	atomic_bool new_peaks;
+	// some monitor's `active` flipped, the peak sort key reorders on the next refresh
+	atomic_bool activity_changed;
+	// counts full paints, see `Monitor.shown`
+	atomic_uint frame;
+	// cleared from the mainloop when the terminal is gone
+	atomic_bool running;
 	InputQueue input_queue;
+	Commands commands;
+	// some entries have `volume_dirty` set
+	bool volume_dirty;
+	// last error, shown until the next key press
+	char status[128];
+	// the entries were loaded from the snapshot and not yet replaced by a resync
+	bool provisional;
+	// a resync completed since the context last became ready, only then the entries are the server's.  Written with
+	// the mainloop lock held.
+	bool synced;
+	EventStats events;
 } App;
 
 extern App app;
 
-void app_init(App *app, pa_context *context, pa_threaded_mainloop *mainloop);
+// entries of the current tab
+static inline Entries *app_page(App *app) {
+	return &app->entries[app->entry_page];
+}
+
+// repaint `rows` of `ent` on the next frame, for changes that keep its size and position
+// caller should hold app-mutex
+static inline void app_entry_dirty(App *app, Entry *ent, uint8_t rows) {
+	if (ent->type != app->entry_page)
+		return;
+	ent->dirty |= rows;
+	atomic_store(&app->should_update, true);
+}
+
+// The facilities of the cached objects.  Every tab's cache is kept current and the stream tabs show sink and source
+// names, so this doesn't depend on the visible tab.  Clients, modules, samples and the server are never shown.
+static const pa_subscription_mask_t app_subscription_mask =
+	(pa_subscription_mask_t)(PA_SUBSCRIPTION_MASK_SINK_INPUT | PA_SUBSCRIPTION_MASK_SOURCE_OUTPUT |
+	                         PA_SUBSCRIPTION_MASK_SINK | PA_SUBSCRIPTION_MASK_SOURCE | PA_SUBSCRIPTION_MASK_CARD);
+
+// one of `mainloop` and `loop` is NULL
+void app_init(App *app, pa_context *context, pa_threaded_mainloop *mainloop, pa_mainloop *loop);
+void app_lock(App *app);
+void app_unlock(App *app);
+void app_wait(App *app);
+void app_signal(App *app);
+pa_mainloop_api *app_api(App *app);
 bool app_refresh_entries(App *app);
+void app_handle_event(App *app, pa_subscription_event_type_t evt, uint32_t index);
+const Label *app_device_name(const App *app, entry_type type, uint32_t device);
+void app_fetch_entry(App *app, entry_type type, uint32_t index);
+void app_monitor_peak(Monitor *mon, float peak, float rms);
+
+// asynchronous commands, see `app_command_start`
+void app_command_done(pa_context *ctx, int success, void *data);
+Command *app_command_new(const Entry *ent, const char *what, bool volume);
+void app_command_start(App *app, Command *cmd, pa_operation *op);
+void app_reap_commands(App *app);
 
 void entry_free(Entry *entry);
+
+// returns false and drops the event when the queue is full
+bool input_queue_push(InputQueue *queue, InputEvent evt);
+bool input_queue_pop(InputQueue *queue, InputEvent *evt);
+bool input_queue_empty(InputQueue *queue);
+
+// rows an entry takes on screen
+static inline int expected_entry_lines(const Entry *ent) {
+	int channel_lines = ent->type == ENTRY_CARD ? 0: (ent->volume_lock ? 1 : ent->channels);
+	return channel_lines + 1 + (ent->type != ENTRY_CARD);
+}
+
+// Entries keeps a hash index from (type, pa_index) to positions in `items`, so items must only be added or removed
+// through these, and `entries_reindex` must be called after reordering items in place.  It also sums up the lines of
+// the items, each with the empty line above it, `entries_lines_changed` must be called when those of an item change.
+int entries_find(const Entries *ents, entry_type type, uint32_t index);
+void entries_append(Entries *ents, Entry ent);
+void entries_remove(Entries *ents, size_t i);
+void entries_reindex(Entries *ents);
+void entries_free(Entries *ents);
+void entries_lines_changed(Entries *ents, size_t i);
+// lines of the items before `i`
+int entries_lines_before(const Entries *ents, size_t i);
+// the number of items that fit into `lines` lines from the top
+size_t entries_fit(const Entries *ents, int lines);
 #endif
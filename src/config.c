@@ -19,14 +19,44 @@ static struct {
 	{ENTRY_CARD, "cards"},
 };
 
+static struct {
+	sort_key k;
+	const char *s;
+} sort_mappings[] = {
+	{SORT_NONE, "none"},
+	{SORT_NAME, "name"},
+	{SORT_APPLICATION, "application"},
+	{SORT_PEAK, "peak"},
+	{SORT_DEVICE, "device"},
+};
+
+static struct {
+	meter_format f;
+	const char *s;
+} meter_format_mappings[] = {
+	{METER_FLOAT32, "float32"},
+	{METER_S16, "s16"},
+	{METER_U8, "u8"},
+};
+
 static bool has_prefix(const char *str, const char *prefix) {
 	while (*str && *prefix && *str++ == *prefix++)
 		;
 	return !*prefix;
 }
 
+// values of the `set` options the config doesn't mention
+static void config_options_default(Config *config) {
+	config->meter_rate = 40;
+	config->meter_fragment = 1;
+	config->meter_format = METER_FLOAT32;
+	config->max_fps = 60;
+	config->snapshot = true;
+}
+
 int config_load(Config *config, const char *path) {
 	memset(config, 0, sizeof(*config));
+	config_options_default(config);
 
 	const char *keynames[KEY_MAX];
 	for (int i = 0; i < KEY_MAX; i++)
@@ -54,7 +84,87 @@ int config_load(Config *config, const char *path) {
 			*comment = '\0';
 
 		if (has_prefix(line, "set ")) {
-			// TODO
+			char *option = line + sizeof("set");
+			char *value = strchr(option, ' ');
+			if (value == NULL) {
+				assert(0 && "missing value");
+				continue;
+			}
+			*value++ = '\0';
+			if (strcmp(option, "sort") == 0) {
+				int idx = -1;
+				for (size_t i = 0; i < sizeof(sort_mappings) / sizeof(*sort_mappings); i++) {
+					if (strcmp(sort_mappings[i].s, value) == 0) {
+						idx = i;
+						break;
+					}
+				}
+				assert(idx != -1);
+				config->sort = sort_mappings[idx].k;
+				continue;
+			}
+			if (strcmp(option, "volume-interval") == 0) {
+				char *end;
+				long ms = strtol(value, &end, 10);
+				assert(*end == '\0' && ms >= 0);
+				config->volume_interval_ms = (unsigned)ms;
+				continue;
+			}
+			if (strcmp(option, "peak-hold") == 0 || strcmp(option, "peak-decay") == 0) {
+				char *end;
+				long n = strtol(value, &end, 10);
+				assert(*end == '\0' && n >= 0);
+				if (strcmp(option, "peak-hold") == 0)
+					config->peak_hold_ms = (unsigned)n;
+				else
+					config->peak_decay = (unsigned)n;
+				continue;
+			}
+			if (strcmp(option, "meter-rate") == 0 || strcmp(option, "meter-fragment") == 0) {
+				char *end;
+				long n = strtol(value, &end, 10);
+				assert(*end == '\0' && n > 0);
+				if (strcmp(option, "meter-rate") == 0)
+					config->meter_rate = (unsigned)n;
+				else
+					config->meter_fragment = (unsigned)n;
+				continue;
+			}
+			if (strcmp(option, "max-fps") == 0 || strcmp(option, "output-budget") == 0) {
+				char *end;
+				long n = strtol(value, &end, 10);
+				assert(*end == '\0' && n >= 0);
+				if (strcmp(option, "max-fps") == 0)
+					config->max_fps = (unsigned)n;
+				else
+					config->output_budget = (unsigned)n;
+				continue;
+			}
+			if (strcmp(option, "meter-format") == 0) {
+				int idx = -1;
+				for (size_t i = 0; i < sizeof(meter_format_mappings) / sizeof(*meter_format_mappings); i++) {
+					if (strcmp(meter_format_mappings[i].s, value) == 0) {
+						idx = i;
+						break;
+					}
+				}
+				assert(idx != -1);
+				config->meter_format = meter_format_mappings[idx].f;
+				continue;
+			}
+			if (strcmp(option, "stats") == 0 || strcmp(option, "channel-meters") == 0 || strcmp(option, "snapshot") == 0 ||
+			    strcmp(option, "single-thread") == 0) {
+				assert(strcmp(value, "on") == 0 || strcmp(value, "off") == 0);
+				if (strcmp(option, "stats") == 0)
+					config->stats = strcmp(value, "on") == 0;
+				else if (strcmp(option, "channel-meters") == 0)
+					config->channel_meters = strcmp(value, "on") == 0;
+				else if (strcmp(option, "snapshot") == 0)
+					config->snapshot = strcmp(value, "on") == 0;
+				else
+					config->single_thread = strcmp(value, "on") == 0;
+				continue;
+			}
 			continue;
 		}
 		if (has_prefix(line, "bind ")) {
@@ -129,6 +239,10 @@ int config_load(Config *config, const char *path) {
 				info->type = ACTION_LOCK_TOGGLE;
 				continue;
 			}
+			if(strcmp(action, "resync") == 0) {
+				info->type = ACTION_RESYNC;
+				continue;
+			}
 			// TODO: tab cycle?
 			continue;
 		}
@@ -143,6 +257,7 @@ int config_load(Config *config, const char *path) {
 }
 
 void config_default(Config *config) {
+	config_options_default(config);
 	config->keymap['q'] = (Action){.type = ACTION_QUIT};
 	for(int i = 0; i < 10; i++)
 		config->keymap['0' + i] = (Action){.type = ACTION_VOLUME_SET, .data = {.volume = i == 0 ? 1.0f : i * 0.1f}};
@@ -16,6 +16,7 @@ typedef enum {
 	ACTION_VOLUME_SET,
 	ACTION_DEVICE_NEXT,
 	ACTION_DEVICE_PREV,
+	ACTION_RESYNC,
 } ActionType;
 
 typedef struct {
@@ -28,6 +29,29 @@ typedef struct {
 
 typedef struct {
 	Action keymap[KEY_MAX];
+	sort_key sort;
+	// minimum time between two set-volume requests for the same entry
+	unsigned volume_interval_ms;
+	// show internal counters below the header
+	bool stats;
+	// peak-hold time, 0 disables the hold marker
+	unsigned peak_hold_ms;
+	// fall rate of the hold marker after the hold time, in percent of full scale per second
+	unsigned peak_decay;
+	// peaks per second and per read of the monitor streams, and their sample format
+	unsigned meter_rate;
+	unsigned meter_fragment;
+	meter_format meter_format;
+	// show a peak meter on each channel row
+	bool channel_meters;
+	// upper bound of painted frames per second, 0 paints every change right away
+	unsigned max_fps;
+	// bytes per second written to the terminal before meter frames are dropped, 0 for no limit
+	unsigned output_budget;
+	// keep the last known entries in $XDG_CACHE_HOME to show them at the next start
+	bool snapshot;
+	// run the PulseAudio mainloop on the main thread instead of its own
+	bool single_thread;
 } Config;
 
 int config_load(Config *config, const char *path);
@@ -6,38 +6,94 @@
 static wchar_t braille[] = { L' ', L'\u2802', L'\u2806', L'\u2807', L'\u280f', L'\u281f', L'\u283f' };
 static int n_braille = (int)(sizeof(braille) / sizeof(*braille));
 
-void draw_volume_bar(int y, int x, int width, pa_volume_t volume) {
+int volume_bar_level(int width, pa_volume_t volume, bool whole_cells) {
 	int segments = width - 2;
 	if (segments <= 0)
-		return;
+		return 0;
+	int steps = n_braille - 1;
 	int fill = (int)((float)volume / (float)(PA_VOLUME_NORM * 1.5) * (float)segments);
-	if(fill > segments)
-		fill = segments;
-	mvaddstr(y, x++, "[");
-	mvaddstr(y, x + segments, "]");
+	if (fill >= segments)
+		return segments * steps;
 
-	wchar_t buf[segments + 1];
-	buf[segments] = 0;
-	for (int i = 0; i < segments; i++)
-		buf[i] = i >= fill ? L' ' : braille[n_braille-1];
-
-	if(volume != PA_VOLUME_MUTED && volume != PA_VOLUME_NORM) {
+	int level = fill * steps;
+	if (!whole_cells && volume != PA_VOLUME_MUTED && volume != PA_VOLUME_NORM) {
 		int segval = (PA_VOLUME_NORM * 1.5) / segments;
-		int subsegval = segval / (n_braille - 1);
+		int subsegval = segval / steps;
 		int idx = (volume % segval) / subsegval;
-		assert(idx <= n_braille - 1);
-		buf[fill] = braille[idx];
+		assert(idx <= steps);
+		level += idx;
 	}
+	return level;
+}
+
+int volume_bar_cell(int width, int level) {
+	int segments = width - 2;
+	int cell = level / (n_braille - 1);
+	return cell < segments ? cell : segments - 1;
+}
+
+void draw_volume_bar_cells(int y, int x, int width, int level, int first, int last) {
+	int segments = width - 2;
+	if (segments <= 0)
+		return;
+	if (first < 0)
+		first = 0;
+	if (last >= segments)
+		last = segments - 1;
+	if (first > last)
+		return;
+	x++;
+
+	int steps = n_braille - 1;
+	wchar_t buf[segments];
+	for (int i = first; i <= last; i++) {
+		int dots = level - i * steps;
+		buf[i] = braille[dots < 0 ? 0 : dots > steps ? steps : dots];
+	}
+
+	// each third of the bar has its own colour
+	int bounds[] = {0, (int)(segments * ((double) 1 / 3)), (int)(segments * ((double) 2 / 3)), segments};
+	for (int pair = 1; pair <= 3; pair++) {
+		int begin = first > bounds[pair - 1] ? first : bounds[pair - 1];
+		int end = last + 1 < bounds[pair] ? last + 1 : bounds[pair];
+		if (begin >= end)
+			continue;
+		attron(COLOR_PAIR(pair));
+		mvaddnwstr(y, x + begin, buf + begin, end - begin);
+		attroff(COLOR_PAIR(pair));
+	}
+}
+
+void draw_volume_bar(int y, int x, int width, pa_volume_t volume) {
+	int segments = width - 2;
+	if (segments <= 0)
+		return;
+	mvaddstr(y, x, "[");
+	mvaddstr(y, x + 1 + segments, "]");
+	draw_volume_bar_cells(y, x, width, volume_bar_level(width, volume, false), 0, segments - 1);
+}
+
+int peak_hold_cell(int width, pa_volume_t volume) {
+	int segments = width - 2;
+	if (segments <= 0 || volume == PA_VOLUME_MUTED)
+		return -1;
+	int pos = (int)((float)volume / (float)(PA_VOLUME_NORM * 1.5) * (float)segments);
+	return pos < segments ? pos : segments - 1;
+}
+
+// marks `volume` on a bar drawn by `draw_volume_bar` with the same geometry
+void draw_peak_hold(int y, int x, int width, pa_volume_t volume) {
+	int segments = width - 2;
+	int pos = peak_hold_cell(width, volume);
+	if (pos < 0)
+		return;
 
-	int indexA = (int)(segments * ((double) 1 / 3));
-	int indexB = (int)(segments * ((double) 2 / 3));
-	attron(COLOR_PAIR(1));
-	mvaddnwstr(y, x, buf, indexA);
-	attroff(COLOR_PAIR(1));
-	attron(COLOR_PAIR(2));
-	mvaddnwstr(y, x + indexA, buf + indexA, indexB - indexA);
-	attroff(COLOR_PAIR(2));
-	attron(COLOR_PAIR(3));
-	mvaddnwstr(y, x + indexB, buf + indexB, segments - indexB);
-	attroff(COLOR_PAIR(3));
+	int pair = 3;
+	if (pos < (int)(segments * ((double) 1 / 3)))
+		pair = 1;
+	else if (pos < (int)(segments * ((double) 2 / 3)))
+		pair = 2;
+	attron(COLOR_PAIR(pair));
+	mvaddstr(y, x + 1 + pos, "|");
+	attroff(COLOR_PAIR(pair));
 }
@@ -1,7 +1,19 @@
 #ifndef _DRAW_H
 #define _DRAW_H
+#include <stdbool.h>
 #include <pulse/volume.h>
 
+// Bars are `width` cells including the brackets.  A level counts the braille dots of the bar, a few per cell, so two
+// volumes that draw the same bar have the same level.
+int volume_bar_level(int width, pa_volume_t volume, bool whole_cells);
+// the cell the level ends in, the only partially filled one
+int volume_bar_cell(int width, int level);
+// redraw cells `first` to `last` of a bar at `level`, leaving the brackets and the other cells alone
+void draw_volume_bar_cells(int y, int x, int width, int level, int first, int last);
 void draw_volume_bar(int y, int x, int width, pa_volume_t volume);
 
+// the cell marked by `draw_peak_hold`, -1 if none
+int peak_hold_cell(int width, pa_volume_t volume);
+void draw_peak_hold(int y, int x, int width, pa_volume_t volume);
+
 #endif
@@ -0,0 +1,147 @@
+#include "app.h"
+#include "da.h"
+#include <stdlib.h>
+#include <string.h>
+
+// open-addressing index from (type, pa_index) to the position of an entry in `Entries.items`.  Slots hold the position
+// plus one, so zero marks an empty slot.  The table is kept at most half full and is rebuilt whenever positions shift
+// (removal, sort), which is O(n) like the memmove/sort that caused it.
+
+static inline size_t entry_hash(entry_type type, uint32_t index) {
+	uint32_t h = index ^ ((uint32_t)type << 29) ^ ((uint32_t)type * 0x9e3779b9u);
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35u;
+	h ^= h >> 16;
+	return h;
+}
+
+static void index_insert(Entries *ents, size_t pos) {
+	const Entry *ent = &ents->items[pos];
+	size_t mask = ents->index.cap - 1;
+	size_t slot = entry_hash(ent->type, ent->pa_index) & mask;
+	while (ents->index.slots[slot] != 0)
+		slot = (slot + 1) & mask;
+	ents->index.slots[slot] = (uint32_t)pos + 1;
+}
+
+// Screen lines are kept in a Fenwick tree, so the lines above an item and the items fitting into some lines take
+// O(log n) for the scroll position.  Appending and changing the lines of one item are O(log n) as well, anything that
+// shifts positions rebuilds the tree along with the hash index.
+
+static inline int item_lines(const Entry *ent) {
+	return expected_entry_lines(ent) + 1;
+}
+
+static void lines_reserve(Entries *ents) {
+	if (ents->lines.cap > ents->len)
+		return;
+	size_t cap = ents->lines.cap == 0 ? 64 : ents->lines.cap;
+	while (cap <= ents->len)
+		cap *= 2;
+	ents->lines.nodes = realloc(ents->lines.nodes, cap * sizeof(*ents->lines.nodes));
+	assert(ents->lines.nodes != NULL);
+	ents->lines.cap = cap;
+}
+
+static void lines_rebuild(Entries *ents) {
+	lines_reserve(ents);
+	int *nodes = ents->lines.nodes;
+	for (size_t k = 1; k <= ents->len; k++)
+		nodes[k] = item_lines(&ents->items[k - 1]);
+	for (size_t k = 1; k <= ents->len; k++) {
+		size_t parent = k + (k & -k);
+		if (parent <= ents->len)
+			nodes[parent] += nodes[k];
+	}
+}
+
+int entries_lines_before(const Entries *ents, size_t i) {
+	assert(i <= ents->len);
+	int lines = 0;
+	for (size_t k = i; k > 0; k -= k & -k)
+		lines += ents->lines.nodes[k];
+	return lines;
+}
+
+void entries_lines_changed(Entries *ents, size_t i) {
+	assert(i < ents->len);
+	int delta = item_lines(&ents->items[i]) - (entries_lines_before(ents, i + 1) - entries_lines_before(ents, i));
+	if (delta == 0)
+		return;
+	for (size_t k = i + 1; k <= ents->len; k += k & -k)
+		ents->lines.nodes[k] += delta;
+}
+
+size_t entries_fit(const Entries *ents, int lines) {
+	size_t step = 1;
+	while (step * 2 <= ents->len)
+		step *= 2;
+	size_t k = 0;
+	for (; step > 0; step /= 2) {
+		if (k + step <= ents->len && ents->lines.nodes[k + step] <= lines) {
+			k += step;
+			lines -= ents->lines.nodes[k];
+		}
+	}
+	return k;
+}
+
+void entries_reindex(Entries *ents) {
+	size_t cap = ents->index.cap == 0 ? 64 : ents->index.cap;
+	while (cap < ents->len * 2)
+		cap *= 2;
+	if (cap != ents->index.cap) {
+		free(ents->index.slots);
+		ents->index.slots = malloc(cap * sizeof(*ents->index.slots));
+		assert(ents->index.slots != NULL);
+		ents->index.cap = cap;
+	}
+	memset(ents->index.slots, 0, cap * sizeof(*ents->index.slots));
+	for (size_t i = 0; i < ents->len; i++)
+		index_insert(ents, i);
+	lines_rebuild(ents);
+}
+
+int entries_find(const Entries *ents, entry_type type, uint32_t index) {
+	if (ents->index.cap == 0)
+		return -1;
+	size_t mask = ents->index.cap - 1;
+	for (size_t slot = entry_hash(type, index) & mask; ents->index.slots[slot] != 0; slot = (slot + 1) & mask) {
+		uint32_t pos = ents->index.slots[slot] - 1;
+		const Entry *ent = &ents->items[pos];
+		if (ent->pa_index == index && ent->type == type)
+			return (int)pos;
+	}
+	return -1;
+}
+
+void entries_append(Entries *ents, Entry ent) {
+	assert(entries_find(ents, ent.type, ent.pa_index) == -1);
+	da_append(ents, ent);
+	if ((ents->len * 2) > ents->index.cap) {
+		entries_reindex(ents);
+		return;
+	}
+	index_insert(ents, ents->len - 1);
+	// the new node covers (k - lowbit(k), k], all but the new item are summed up already
+	size_t k = ents->len;
+	lines_reserve(ents);
+	ents->lines.nodes[k] = item_lines(&ents->items[k - 1]) + entries_lines_before(ents, k - 1) -
+	                       entries_lines_before(ents, k - (k & -k));
+}
+
+void entries_remove(Entries *ents, size_t i) {
+	assert(i < ents->len);
+	memmove(ents->items + i, ents->items + i + 1, (ents->len - i - 1) * sizeof(Entry));
+	ents->len--;
+	entries_reindex(ents);
+}
+
+void entries_free(Entries *ents) {
+	free(ents->items);
+	free(ents->index.slots);
+	free(ents->lines.nodes);
+	memset(ents, 0, sizeof(*ents));
+}
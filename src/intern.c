@@ -0,0 +1,114 @@
+#include "intern.h"
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+// strings live behind their header, the table maps the hash of the text to the header with linear probing and is
+// kept at most half full.  Removal shifts the following entries of the probe run back, so there are no tombstones.
+
+typedef struct {
+	unsigned refs;
+	uint32_t hash;
+	char text[];
+} Interned;
+
+static struct {
+	Interned **slots;
+	size_t cap;
+	InternStats stats;
+} table;
+
+static uint32_t text_hash(const char *text) {
+	// FNV-1a
+	uint32_t h = 2166136261u;
+	for (const unsigned char *s = (const unsigned char *)text; *s != '\0'; s++) {
+		h ^= *s;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+static inline Interned *interned_of(const char *text) {
+	return (Interned *)(text - offsetof(Interned, text));
+}
+
+static void table_insert(Interned *str) {
+	size_t mask = table.cap - 1;
+	size_t slot = str->hash & mask;
+	while (table.slots[slot] != NULL)
+		slot = (slot + 1) & mask;
+	table.slots[slot] = str;
+}
+
+static void table_grow(void) {
+	Interned **old = table.slots;
+	size_t old_cap = table.cap;
+	table.cap = old_cap == 0 ? 256 : old_cap * 2;
+	table.slots = calloc(table.cap, sizeof(*table.slots));
+	assert(table.slots != NULL);
+	for (size_t i = 0; i < old_cap; i++) {
+		if (old[i] != NULL)
+			table_insert(old[i]);
+	}
+	free(old);
+}
+
+const char *intern(const char *text) {
+	uint32_t hash = text_hash(text);
+	if (table.cap != 0) {
+		size_t mask = table.cap - 1;
+		for (size_t slot = hash & mask; table.slots[slot] != NULL; slot = (slot + 1) & mask) {
+			Interned *str = table.slots[slot];
+			if (str->hash == hash && strcmp(str->text, text) == 0) {
+				str->refs++;
+				return str->text;
+			}
+		}
+	}
+
+	if ((table.stats.strings + 1) * 2 > table.cap)
+		table_grow();
+	size_t len = strlen(text);
+	Interned *str = malloc(sizeof(*str) + len + 1);
+	assert(str != NULL);
+	str->refs = 1;
+	str->hash = hash;
+	memcpy(str->text, text, len + 1);
+	table_insert(str);
+	table.stats.strings++;
+	table.stats.allocations++;
+	return str->text;
+}
+
+void intern_release(const char *text) {
+	if (text == NULL)
+		return;
+	Interned *str = interned_of(text);
+	assert(str->refs > 0);
+	if (--str->refs > 0)
+		return;
+
+	size_t mask = table.cap - 1;
+	size_t slot = str->hash & mask;
+	while (table.slots[slot] != str)
+		slot = (slot + 1) & mask;
+	table.slots[slot] = NULL;
+	// move entries that probed past the freed slot back into it
+	for (size_t next = (slot + 1) & mask; table.slots[next] != NULL; next = (next + 1) & mask) {
+		size_t home = table.slots[next]->hash & mask;
+		// the entry may move if its home isn't cyclically within (slot, next]
+		if ((next > slot && (home <= slot || home > next)) || (next < slot && home <= slot && home > next)) {
+			table.slots[slot] = table.slots[next];
+			table.slots[next] = NULL;
+			slot = next;
+		}
+	}
+	free(str);
+	table.stats.strings--;
+	table.stats.frees++;
+}
+
+InternStats intern_stats(void) {
+	return table.stats;
+}
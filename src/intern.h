@@ -0,0 +1,25 @@
+#ifndef _INTERN_H
+#define _INTERN_H
+
+#include <stddef.h>
+
+// Interned strings are shared by everyone holding the same text and freed with the last reference.  They are used for
+// names and descriptions the server repeats with every update, so unchanged ones cost a lookup instead of a copy.
+// Not thread-safe, callers should hold app-mutex.
+
+typedef struct {
+	// distinct strings alive
+	size_t strings;
+	// totals since start
+	size_t allocations;
+	size_t frees;
+} InternStats;
+
+// a reference to the interned copy of `text`
+const char *intern(const char *text);
+// drop a reference, NULL is ignored
+void intern_release(const char *text);
+
+InternStats intern_stats(void);
+
+#endif
@@ -0,0 +1,82 @@
+#include "label.h"
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wchar.h>
+
+// the end of the longest prefix of `text` at most `cells` wide, its width is stored in `width`
+static const char *text_prefix(const char *text, int cells, int *width) {
+	mbstate_t state;
+	memset(&state, 0, sizeof(state));
+	const char *s = text;
+	int w = 0;
+	while (*s != '\0') {
+		wchar_t wc;
+		size_t len = mbrtowc(&wc, s, MB_CUR_MAX, &state);
+		int cw = 1;
+		if (len == (size_t)-1 || len == (size_t)-2) {
+			// invalid sequences are shown byte by byte
+			len = 1;
+			memset(&state, 0, sizeof(state));
+		} else {
+			cw = wcwidth(wc);
+			if (cw < 0)
+				cw = 0;
+		}
+		if (w + cw > cells)
+			break;
+		w += cw;
+		s += len;
+	}
+	*width = w;
+	return s;
+}
+
+int text_width(const char *text) {
+	int width;
+	text_prefix(text, 1 << 30, &width);
+	return width;
+}
+
+bool label_set(Label *label, const char *text) {
+	if (text == NULL)
+		text = "";
+	if (label->text != NULL && strcmp(label->text, text) == 0)
+		return false;
+	free(label->text);
+	free(label->fit);
+	label->text = strdup(text);
+	assert(label->text != NULL);
+	label->width = text_width(text);
+	label->fit = NULL;
+	label->fit_cells = 0;
+	return true;
+}
+
+const char *label_fit(Label *label, int cells) {
+	if (label->text == NULL)
+		return "";
+	if (label->width <= cells)
+		return label->text;
+	if (cells < 3)
+		return &"..."[3 - (cells > 0 ? cells : 0)];
+	if (label->fit != NULL && label->fit_cells == cells)
+		return label->fit;
+
+	int width;
+	size_t len = text_prefix(label->text, cells - 3, &width) - label->text;
+	free(label->fit);
+	label->fit = malloc(len + 4);
+	assert(label->fit != NULL);
+	memcpy(label->fit, label->text, len);
+	memcpy(label->fit + len, "...", 4);
+	label->fit_cells = cells;
+	return label->fit;
+}
+
+void label_free(Label *label) {
+	free(label->text);
+	free(label->fit);
+	label->text = NULL;
+	label->fit = NULL;
+}
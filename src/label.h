@@ -0,0 +1,25 @@
+#ifndef _LABEL_H
+#define _LABEL_H
+
+#include <stdbool.h>
+
+// A string shown on screen with its width in terminal cells.  The form cut to fit a space is kept until the text or
+// the space changes, so repaints neither measure nor truncate anything.
+typedef struct {
+	char *text;
+	int width;
+	// `text` cut to `fit_cells` cells with an ellipsis, NULL until it didn't fit once
+	char *fit;
+	int fit_cells;
+} Label;
+
+// width of a multibyte string in terminal cells
+int text_width(const char *text);
+
+// replace the text, NULL is stored as an empty text.  Returns whether it changed.
+bool label_set(Label *label, const char *text);
+// the text, or if it is wider than `cells` its cut form ending in "..."
+const char *label_fit(Label *label, int cells);
+void label_free(Label *label);
+
+#endif
@@ -1,18 +1,24 @@
 #include <assert.h>
+#include <fcntl.h>
 #include <locale.h>
 #include <ncurses.h>
 #include <pthread.h>
 #include <pulse/pulseaudio.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 #include <signal.h>
+#include <sys/resource.h>
+#include <sys/signalfd.h>
 
 #include "app.h"
 #include "da.h"
 #include "draw.h"
 #include "config.h"
+#include "intern.h"
+#include "snapshot.h"
 
 struct line_expect {
 	int begin;
@@ -24,148 +30,198 @@ void line_expect_check(struct line_expect *e) {
 	int count = (*e->end) - e->begin;
 	assert(e->expected == count);
 }
-static inline int expected_entry_lines(const Entry *ent) {
-	int channel_lines = ent->type == ENTRY_CARD ? 0: (ent->volume_lock ? 1 : ent->volume.channels);
-	return channel_lines + 1 + (ent->type != ENTRY_CARD);
-}
 
 int compute_entry_scroll(void);
 
-void on_ctx_state(pa_context *ctx, void *data) {
-	(void)ctx;
-	pa_threaded_mainloop *mainloop = (pa_threaded_mainloop *)data;
-	pa_threaded_mainloop_signal(mainloop, false);
-}
-
 void on_ctx_subscription(pa_context *ctx, pa_subscription_event_type_t evt_type, uint32_t index, void *data) {
 	(void)ctx;
-	(void)evt_type;
-	(void)index;
 	(void)data;
-	atomic_store(&app.should_refresh, true);
-	pa_threaded_mainloop_signal(app.pa_mainloop, false);
+	app_handle_event(&app, evt_type, index);
 }
 
-void cb_success_signal(pa_context *ctx, int succ, void *data) {
-	(void)ctx;
-	(void)succ;
+// SIGWINCH is blocked in all threads and read from a signalfd, so it arrives as an ordinary mainloop callback
+void on_resize_signal(pa_mainloop_api *api, pa_io_event *event, int fd, pa_io_event_flags_t flags, void *data) {
+	(void)api;
+	(void)event;
+	(void)flags;
 	(void)data;
-	pa_threaded_mainloop_signal(app.pa_mainloop, false);
-}
-
-void on_signal_resize(int signal) {
-	(void)signal;
+	struct signalfd_siginfo info;
+	while (read(fd, &info, sizeof(info)) == sizeof(info))
+		;
 	atomic_store(&app.resized, true);
-	pa_threaded_mainloop_signal(app.pa_mainloop, false);
+	app_signal(&app);
 }
 
-void *input_thread_main(void *data) {
+// keys are read through their own window, which is never drawn to, so reading never refreshes stdscr
+static WINDOW *input_win;
+static pa_io_event *stdin_event;
+// rtclock time stdin became readable, 0 once its keys were read.  ncurses isn't thread-safe, so the mainloop only
+// reports that input is waiting and the main loop reads it in `read_keys`.
+static atomic_ullong stdin_ready;
+
+// runs on the mainloop whenever stdin becomes readable, so nothing polls the terminal while idle
+void on_stdin_ready(pa_mainloop_api *api, pa_io_event *event, int fd, pa_io_event_flags_t flags, void *data) {
+	(void)fd;
 	(void)data;
-	while (app.running) {
-		pthread_mutex_lock(&app.mutex);
-		int ch = getch();
-		pthread_mutex_unlock(&app.mutex);
+	// until `read_keys` took the input, which enables the event again
+	api->io_enable(event, PA_IO_EVENT_NULL);
+	if (flags & (PA_IO_EVENT_HANGUP | PA_IO_EVENT_ERROR)) {
+		// the terminal is gone
+		atomic_store(&app.running, false);
+		app_signal(&app);
+		return;
+	}
+	atomic_store(&stdin_ready, pa_rtclock_now());
+	app_signal(&app);
+}
+
+// Decode the keys waiting on stdin into the input queue.
+// caller should hold mainloop
+static void read_keys(void) {
+	pa_usec_t at = atomic_exchange(&stdin_ready, 0);
+	if (at == 0)
+		return;
+	int ch;
+	// ncurses may have buffered more than one key from this read, those won't make stdin readable again
+	while ((ch = wgetch(input_win)) != ERR) {
 #ifdef KEY_RESIZE
 		if (ch == KEY_RESIZE) {
 			atomic_store(&app.resized, true);
+			continue;
 		}
 #endif
-
-		bool key_valid = ch != ERR && ch != KEY_RESIZE && ch != KEY_MOUSE;
-		if (key_valid) {
-			InputEvent evt = {
-				.keycode = ch,
-				.keyname = keyname(ch),
-			};
-			assert(evt.keyname != NULL);
-			pthread_mutex_lock(&app.mutex);
-			da_append(&app.input_queue, evt);
-			pthread_mutex_unlock(&app.mutex);
-		}
-		if (key_valid || ch == KEY_RESIZE) {
-			pa_threaded_mainloop_signal(app.pa_mainloop, false);
-		}
-		usleep(2000);
+		if (ch == KEY_MOUSE)
+			continue;
+		InputEvent evt = {
+			.keycode = ch,
+			.keyname = keyname(ch),
+			.at = at,
+		};
+		assert(evt.keyname != NULL);
+		// a full queue means the keys come in faster than they are handled, the rest is dropped
+		input_queue_push(&app.input_queue, evt);
 	}
-	return NULL;
+	pa_mainloop_api *api = app_api(&app);
+	api->io_enable(stdin_event, PA_IO_EVENT_INPUT);
 }
 
-static void reconnect_cleanup_mainloop(void *mainloop) {
-	pa_threaded_mainloop_unlock(mainloop);
+// Reconnecting is driven by the context state.  A lost or refused connection is retried right away, further attempts
+// wait exponentially longer up to RECONNECT_MAX_DELAY.  The delays are jittered, so clients of a restarted server
+// don't all come back at once.
+#define RECONNECT_MIN_DELAY (100 * PA_USEC_PER_MSEC)
+#define RECONNECT_MAX_DELAY (10 * PA_USEC_PER_SEC)
+
+static pa_time_event *reconnect_event;
+// failed attempts since the last context that got its subscription
+static unsigned reconnect_attempts;
+static uint32_t jitter_state;
+
+static void connect_context(void);
+
+static pa_usec_t reconnect_delay(void) {
+	if (reconnect_attempts++ == 0)
+		return 0;
+	// the first delayed attempt is the second one
+	pa_usec_t delay = RECONNECT_MIN_DELAY;
+	for (unsigned i = 2; i < reconnect_attempts && delay < RECONNECT_MAX_DELAY; i++)
+		delay *= 2;
+	if (delay > RECONNECT_MAX_DELAY)
+		delay = RECONNECT_MAX_DELAY;
+	// xorshift32, anywhere in the upper half of the delay
+	jitter_state ^= jitter_state << 13;
+	jitter_state ^= jitter_state >> 17;
+	jitter_state ^= jitter_state << 5;
+	return delay / 2 + jitter_state % (delay / 2 + 1);
 }
 
-void *reconnect_thread_main(void *arg) {
-	(void)arg;
-	while (app.running) {
-		pa_proplist *props;
-		pa_mainloop_api *api;
-		int err;
-		pthread_cleanup_push(reconnect_cleanup_mainloop, app.pa_mainloop);
-		pa_threaded_mainloop_lock(app.pa_mainloop);
-		pthread_mutex_lock(&app.mutex);
-		if (app.pa_context != NULL && pa_context_get_state(app.pa_context) == PA_CONTEXT_READY) {
-			goto sleep;
-		}
-		if (app.pa_context != NULL) {
-			pa_context_unref(app.pa_context);
-			app.pa_context = NULL;
-		}
+static void on_reconnect(pa_mainloop_api *api, pa_time_event *event, const struct timeval *tv, void *data) {
+	(void)api;
+	(void)event;
+	(void)tv;
+	(void)data;
+	connect_context();
+}
 
-		props = pa_proplist_new();
-		pa_proplist_sets(props, PA_PROP_APPLICATION_ID, "testerino");
-		pa_proplist_sets(props, PA_PROP_APPLICATION_NAME, "testerino");
-		api = pa_threaded_mainloop_get_api(app.pa_mainloop);
-		app.pa_context = pa_context_new_with_proplist(api, "testerino", props);
-		pa_proplist_free(props);
-		pa_context_set_state_callback(app.pa_context, &on_ctx_state, app.pa_mainloop);
-		err = pa_context_connect(app.pa_context, NULL, (pa_context_flags_t)PA_CONTEXT_NOAUTOSPAWN, NULL);
-		if (err != 0) {
-			pa_context_unref(app.pa_context);
-			app.pa_context = NULL;
-			// TODO: on error we probably want to sleep with the lock held, so noone else does any funny business
-			goto sleep;
-		}
-		pa_context_state_t state;
-		pthread_mutex_unlock(&app.mutex);
-		while((state = pa_context_get_state(app.pa_context)) != PA_CONTEXT_READY){
-			if(!PA_CONTEXT_IS_GOOD(state)) {
-				pthread_mutex_lock(&app.mutex);
-				goto sleep;
-			}
-			assert(PA_CONTEXT_IS_GOOD(state));
-			pa_threaded_mainloop_wait(app.pa_mainloop);
-		}
-		pthread_mutex_lock(&app.mutex);
-		{
-			pa_context_set_subscribe_callback(app.pa_context, &on_ctx_subscription, NULL);
-			pa_subscription_mask_t submask = PA_SUBSCRIPTION_MASK_ALL;
-			pa_operation *op = pa_context_subscribe(app.pa_context, submask, &cb_success_signal, app.pa_mainloop);
+// caller should hold mainloop
+static void schedule_reconnect(void) {
+	struct timeval tv;
+	pa_timeval_add(pa_gettimeofday(&tv), reconnect_delay());
+	pa_mainloop_api *api = app_api(&app);
+	if (reconnect_event == NULL)
+		reconnect_event = api->time_new(api, &tv, &on_reconnect, NULL);
+	else
+		api->time_restart(reconnect_event, &tv);
+}
 
-			pa_operation_state_t opstate;
-			pthread_mutex_unlock(&app.mutex);
-			while ((opstate = pa_operation_get_state(op)) == PA_OPERATION_RUNNING) {
-				pa_threaded_mainloop_wait(app.pa_mainloop);
-			}
-			pthread_mutex_lock(&app.mutex);
+void on_ctx_subscribed(pa_context *ctx, int success, void *data) {
+	(void)data;
+	if (!success) {
+		// the state callback schedules the next attempt
+		pa_context_disconnect(ctx);
+		return;
+	}
+	// only a subscribed context is usable, a server refusing the subscription keeps backing off
+	reconnect_attempts = 0;
+	atomic_store(&app.should_resync, true);
+	atomic_store(&app.should_refresh, true);
+	app_signal(&app);
+}
+
+void on_ctx_state(pa_context *ctx, void *data) {
+	(void)data;
+	switch (pa_context_get_state(ctx)) {
+	case PA_CONTEXT_READY: {
+		app.synced = false;
+		pa_context_set_subscribe_callback(ctx, &on_ctx_subscription, NULL);
+		pa_operation *op = pa_context_subscribe(ctx, app_subscription_mask, &on_ctx_subscribed, NULL);
+		// without a subscription the entries would never be synced, the next attempt may subscribe
+		if (op == NULL)
+			pa_context_disconnect(ctx);
+		else
 			pa_operation_unref(op);
-			if(opstate != PA_OPERATION_DONE)
-				goto sleep;
-		}
+		break;
+	}
+	case PA_CONTEXT_FAILED:
+	case PA_CONTEXT_TERMINATED:
+		if (atomic_load(&app.running))
+			schedule_reconnect();
+		break;
+	default:
+		break;
+	}
+	// the main loop shows the waiting screen while not ready
+	app_signal(&app);
+}
 
-		atomic_store(&app.should_refresh, true);
-		pa_threaded_mainloop_signal(app.pa_mainloop, false);
+// Replace the context by a new connection attempt, its outcome arrives in `on_ctx_state`.  The old context is only
+// dropped here, never from its own callbacks.
+// caller should hold mainloop
+static void connect_context(void) {
+	pa_mainloop_api *api = app_api(&app);
+	pa_proplist *props = pa_proplist_new();
+	pa_proplist_sets(props, PA_PROP_APPLICATION_ID, "testerino");
+	pa_proplist_sets(props, PA_PROP_APPLICATION_NAME, "testerino");
+	pa_context *ctx = pa_context_new_with_proplist(api, "testerino", props);
+	pa_proplist_free(props);
+	assert(ctx != NULL);
+	pa_context_set_state_callback(ctx, &on_ctx_state, NULL);
 
-	sleep:
-		pthread_mutex_unlock(&app.mutex);
-		// pa_threaded_mainloop_unlock
-		pthread_cleanup_pop(true);
-		sleep(2);
+	pthread_mutex_lock(&app.mutex);
+	if (app.pa_context != NULL) {
+		pa_context_set_state_callback(app.pa_context, NULL, NULL);
+		pa_context_unref(app.pa_context);
 	}
-	return NULL;
+	app.pa_context = ctx;
+	pthread_mutex_unlock(&app.mutex);
+
+	// failures past this point are reported through the state callback
+	if (pa_context_connect(ctx, NULL, (pa_context_flags_t)PA_CONTEXT_NOAUTOSPAWN, NULL) < 0 &&
+	    pa_context_get_state(ctx) == PA_CONTEXT_UNCONNECTED)
+		schedule_reconnect();
 }
 
-pa_operation *entry_set_volume(Entry ent, const pa_cvolume *volume) {
-#define OP(name) pa_context_set_##name(app.pa_context, ent.pa_index, volume, &cb_success_signal, NULL)
+pa_operation *entry_set_volume(Entry ent, const pa_cvolume *volume, Command *cmd) {
+#define OP(name) pa_context_set_##name(app.pa_context, ent.pa_index, volume, &app_command_done, cmd)
 	switch (ent.type) {
 	case ENTRY_SINKINPUT:
 		return OP(sink_input_volume);
@@ -182,8 +238,8 @@ pa_operation *entry_set_volume(Entry ent, const pa_cvolume *volume) {
 #undef OP
 }
 
-pa_operation *entry_set_muted(Entry ent, bool mute) {
-#define OP(name) pa_context_set_##name(app.pa_context, ent.pa_index, mute, &cb_success_signal, NULL)
+pa_operation *entry_set_muted(Entry ent, bool mute, Command *cmd) {
+#define OP(name) pa_context_set_##name(app.pa_context, ent.pa_index, mute, &app_command_done, cmd)
 	switch (ent.type) {
 	case ENTRY_SINKINPUT:
 		return OP(sink_input_mute);
@@ -200,225 +256,706 @@ pa_operation *entry_set_muted(Entry ent, bool mute) {
 #undef OP
 }
 
-void collect_sink_indices(pa_context *ctx, const pa_sink_info *i, int eol, void *userdata) {
-	(void)ctx;
-	if (eol) {
-		assert(i == NULL);
-		pa_threaded_mainloop_signal(app.pa_mainloop, false);
+static pa_time_event *wakeup_event;
+// rtclock time the event fires at, 0 while it is not pending
+static pa_usec_t wakeup_at;
+
+static void on_wakeup(pa_mainloop_api *api, pa_time_event *event, const struct timeval *tv, void *data) {
+	(void)api;
+	(void)event;
+	(void)tv;
+	(void)data;
+	wakeup_at = 0;
+	app_signal(&app);
+}
+
+// wake the main loop after `delay`, unless it is already woken earlier.  Volume flushes and frames share the event.
+// caller should hold mainloop
+static void schedule_wakeup(pa_usec_t delay) {
+	pa_usec_t at = pa_rtclock_now() + delay;
+	if (wakeup_at != 0 && wakeup_at <= at)
+		return;
+	wakeup_at = at;
+	struct timeval tv;
+	pa_timeval_add(pa_gettimeofday(&tv), delay);
+	pa_mainloop_api *api = app_api(&app);
+	if (wakeup_event == NULL)
+		wakeup_event = api->time_new(api, &tv, &on_wakeup, NULL);
+	else
+		api->time_restart(wakeup_event, &tv);
+}
+
+// rtclock time the first entry left dirty by `flush_volume_changes` may be sent, 0 if it may be sent right away
+static pa_usec_t volume_due;
+
+// Send the volume of each entry changed since the last frame in a single request, at most once per
+// `volume_interval_ms` per entry.  Entries still within their interval stay dirty and are sent once it passed.  Only
+// called once per frame, so held keys send at most one request per entry and frame.
+// caller should hold mainloop and app-mutex
+static void flush_volume_changes(const Config *cfg) {
+	if (!app.volume_dirty)
 		return;
+	app.volume_dirty = false;
+
+	pa_usec_t now = pa_rtclock_now();
+	pa_usec_t interval = (pa_usec_t)cfg->volume_interval_ms * PA_USEC_PER_MSEC;
+	pa_usec_t next = 0;
+	for (size_t t = 0; t <= ENTRY_CARD; t++) {
+		for (size_t i = 0; i < app.entries[t].len; i++) {
+			Entry *ent = &app.entries[t].items[i];
+			if (!ent->volume_dirty)
+				continue;
+			pa_usec_t due = ent->detail->volume_sent + interval;
+			if (due > now) {
+				app.volume_dirty = true;
+				if (next == 0 || due < next)
+					next = due;
+				continue;
+			}
+			ent->volume_dirty = false;
+			ent->detail->volume_sent = now;
+			Command *cmd = app_command_new(ent, "set volume", true);
+			app_command_start(&app, cmd, entry_set_volume(*ent, &ent->detail->volume, cmd));
+		}
 	}
-	pthread_mutex_lock(&app.mutex);
-	uint32_t **ptr = (uint32_t **)userdata;
-	*((*ptr)++) = i->index;
-	pthread_mutex_unlock(&app.mutex);
+	volume_due = next;
+	if (next != 0)
+		schedule_wakeup(next - now);
 }
 
-void collect_source_indices(pa_context *ctx, const pa_source_info *i, int eol, void *userdata) {
-	(void)ctx;
-	if (eol) {
-		assert(i == NULL);
-		pa_threaded_mainloop_signal(app.pa_mainloop, false);
+// Terminal output allowance of `set output-budget`, a bucket refilled with `limit` bytes per second that holds at most
+// one second worth.  Meter frames are dropped while it is empty, everything else is painted and may overdraw it.
+static struct {
+	uint64_t limit;
+	double bytes;
+	pa_usec_t refilled;
+	uint64_t written;
+	bool accounted;
+	// meter frames dropped since start
+	size_t dropped;
+} output_budget;
+
+// lines of the meters on screen, so new peaks repaint only those
+struct EntLine {
+	const Monitor *monitor;
+	uint32_t line;
+	// the channel of a channel row, -1 for the peak bar of the entry
+	int channel;
+	// bar level and hold marker cell as last drawn, to redraw only the cells that changed
+	int level;
+	int hold;
+};
+struct EntLines {
+	struct EntLine *items;
+	size_t len;
+	size_t cap;
+};
+static struct EntLines entry_lines;
+
+// the meter drawn on `line` by the last full paint
+static struct EntLine *entry_line(int line, int channel) {
+	for (size_t i = 0; i < entry_lines.len; i++) {
+		if (entry_lines.items[i].line == (uint32_t)line && entry_lines.items[i].channel == channel)
+			return &entry_lines.items[i];
+	}
+	return NULL;
+}
+
+// The peak meter of an entry spans the line, a channel meter sits between the channel name and its volume bar.  After
+// the first draw only the cells that changed are redrawn.  On a budget the meters move in whole cells, which leaves
+// fewer cells changed per peak.
+static void draw_meter(struct EntLine *el, bool hold, bool first) {
+	int x = el->channel >= 0 ? 18 : 1;
+	int width = el->channel >= 0 ? 13 : COLS - 2;
+	float peak = monitor_peak(el->monitor);
+	if (peak >= 0 && el->channel >= 0)
+		peak = monitor_channel_peak(el->monitor, el->channel);
+	int level = peak >= 0 ? volume_bar_level(width, peak * PA_VOLUME_NORM, output_budget.limit != 0) : 0;
+	pa_volume_t hold_volume = PA_VOLUME_MUTED;
+	if (hold && el->channel < 0 && peak >= 0)
+		hold_volume = monitor_hold(el->monitor) * PA_VOLUME_NORM;
+	int hold_cell = peak_hold_cell(width, hold_volume);
+
+	if (first) {
+		mvaddstr(el->line, x, "[");
+		mvaddstr(el->line, x + width - 1, "]");
+		draw_volume_bar_cells(el->line, x, width, level, 0, width - 3);
+	} else {
+		if (level == el->level && hold_cell == el->hold)
+			return;
+		int from = volume_bar_cell(width, el->level);
+		int to = volume_bar_cell(width, level);
+		draw_volume_bar_cells(el->line, x, width, level, from < to ? from : to, from < to ? to : from);
+		if (el->hold >= 0 && el->hold != hold_cell)
+			draw_volume_bar_cells(el->line, x, width, level, el->hold, el->hold);
+	}
+	if (hold_cell >= 0)
+		draw_peak_hold(el->line, x, width, hold_volume);
+	el->level = level;
+	el->hold = hold_cell;
+}
+
+// bytes the calling thread wrote so far, taken from the kernel's per-thread I/O accounting
+static bool thread_written(uint64_t *bytes) {
+	static int fd = -2;
+	if (fd == -2)
+		fd = open("/proc/thread-self/io", O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+	char buf[512];
+	ssize_t len = pread(fd, buf, sizeof(buf) - 1, 0);
+	if (len <= 0)
+		return false;
+	buf[len] = '\0';
+	const char *field = strstr(buf, "wchar: ");
+	if (field == NULL)
+		return false;
+	*bytes = strtoull(field + strlen("wchar: "), NULL, 10);
+	return true;
+}
+
+// Frames presented and bytes written to the terminal, summed up once per second.  Only the main thread writes to the
+// terminal, so its written bytes are the terminal output.
+static struct {
+	pa_usec_t since;
+	unsigned frames;
+	uint64_t written;
+	bool accounted;
+	// context switches of all threads so far
+	long switches;
+	// read time of the oldest key not yet shown by a frame, 0 if none
+	pa_usec_t key_at;
+	// longest time from reading a key to the frame showing it
+	pa_usec_t key_latency;
+	// figures of the last full second
+	unsigned fps;
+	uint64_t bytes_per_sec;
+	long switches_per_sec;
+	pa_usec_t key_latency_max;
+} output_stats;
+
+// whether a meter frame fits into `set output-budget`, refills the bucket for the time passed
+static bool output_budget_allows(void) {
+	if (output_budget.limit == 0)
+		return true;
+	pa_usec_t now = pa_rtclock_now();
+	if (output_budget.refilled == 0)
+		output_budget.bytes = output_budget.limit;
+	else
+		output_budget.bytes += (double)output_budget.limit * (now - output_budget.refilled) / PA_USEC_PER_SEC;
+	if (output_budget.bytes > output_budget.limit)
+		output_budget.bytes = output_budget.limit;
+	output_budget.refilled = now;
+	return output_budget.bytes > 0;
+}
+
+// pay for the bytes written since the last frame, without I/O accounting the budget only quantizes the meters
+static void output_budget_charge(void) {
+	uint64_t written;
+	if (output_budget.limit == 0 || !thread_written(&written))
 		return;
+	if (output_budget.accounted)
+		output_budget.bytes -= written - output_budget.written;
+	output_budget.written = written;
+	output_budget.accounted = true;
+}
+
+static void present(void) {
+	refresh();
+	output_budget_charge();
+	output_stats.frames++;
+	pa_usec_t now = pa_rtclock_now();
+	if (output_stats.key_at != 0) {
+		if (now - output_stats.key_at > output_stats.key_latency)
+			output_stats.key_latency = now - output_stats.key_at;
+		output_stats.key_at = 0;
 	}
-	pthread_mutex_lock(&app.mutex);
-	uint32_t **ptr = (uint32_t **)userdata;
-	*((*ptr)++) = i->index;
-	pthread_mutex_unlock(&app.mutex);
+	if (output_stats.since != 0 && now - output_stats.since < PA_USEC_PER_SEC)
+		return;
+	uint64_t written = 0;
+	bool accounted = thread_written(&written);
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	long switches = usage.ru_nvcsw + usage.ru_nivcsw;
+	if (output_stats.since != 0) {
+		double secs = (double)(now - output_stats.since) / PA_USEC_PER_SEC;
+		output_stats.fps = (unsigned)(output_stats.frames / secs + 0.5);
+		if (accounted && output_stats.accounted)
+			output_stats.bytes_per_sec = (uint64_t)((written - output_stats.written) / secs);
+		output_stats.switches_per_sec = (long)((switches - output_stats.switches) / secs + 0.5);
+	}
+	output_stats.since = now;
+	output_stats.frames = 0;
+	output_stats.written = written;
+	output_stats.accounted = accounted;
+	output_stats.switches = switches;
+	output_stats.key_latency_max = output_stats.key_latency;
+	output_stats.key_latency = 0;
+}
+
+// internal counters for `set stats on`, drawn into the empty line below the header
+// caller should hold app-mutex
+static void draw_stats(int y) {
+	MonitorStats mon = monitor_stats();
+	InternStats strings = intern_stats();
+	char buf[480];
+	int len = snprintf(buf, sizeof(buf), "monitors: %zu streams, %zu pooled, %zu created, %zu destroyed, %zu reused | "
+	                   "strings: %zu, %zu allocated, %zu freed | events: %zu received, %zu ignored, %zu unchanged | "
+	                   "%u fps, ", mon.streams, mon.pooled, mon.created, mon.destroyed, mon.reused, strings.strings,
+	                   strings.allocations, strings.frees, atomic_load(&app.events.received),
+	                   atomic_load(&app.events.ignored), atomic_load(&app.events.unchanged), output_stats.fps);
+	if (output_stats.accounted)
+		len += snprintf(buf + len, sizeof(buf) - len, "%llu B/s", (unsigned long long)output_stats.bytes_per_sec);
+	else
+		len += snprintf(buf + len, sizeof(buf) - len, "n/a B/s");
+	len += snprintf(buf + len, sizeof(buf) - len, ", %ld switches/s, %.1f ms key latency", output_stats.switches_per_sec,
+	                (double)output_stats.key_latency_max / PA_USEC_PER_MSEC);
+	if (output_budget.limit != 0)
+		snprintf(buf + len, sizeof(buf) - len, ", %zu meter frames dropped", output_budget.dropped);
+	move(y, 0);
+	clrtoeol();
+	mvaddnstr(y, 1, buf, COLS - 2);
+}
+
+static bool frame_pending(void) {
+	return atomic_load(&app.should_refresh) || atomic_load(&app.should_redraw) || atomic_load(&app.should_update) ||
+	       atomic_load(&app.new_peaks) || (app.volume_dirty && volume_due <= pa_rtclock_now());
 }
 
-#define RUN_OPERATION_OR_RETURN(operation, ostate, or_return) \
-	do { \
-		assert(operation != NULL); \
-		pthread_mutex_unlock(&app.mutex); \
-		while(((ostate) = pa_operation_get_state(operation)) == PA_OPERATION_RUNNING) \
-			pa_threaded_mainloop_wait(app.pa_mainloop); \
-		pthread_mutex_lock(&app.mutex); \
-		pa_operation_unref(operation); \
-		if((ostate) == PA_OPERATION_CANCELLED) { \
-			return or_return; \
-		}\
-		assert((ostate) == PA_OPERATION_DONE);\
-	} while(0)
+// caller should hold app-mutex
+static void draw_header(const Config *cfg) {
+	const char *entry_type_names[] = {"Playback", "Recording", "Output Devices", "Input Devices", "Cards"};
+	move(0, 0);
+	clrtoeol();
+	move(0, 1);
+	printw("%d/%zu", app.selected_entry + 1, app_page(&app)->len);
+	mvaddstr(0, 10, entry_type_names[app.entry_page]);
+	if (app.status[0] != '\0') {
+		attron(COLOR_PAIR(3));
+		mvaddstr(0, 26, app.status);
+		attroff(COLOR_PAIR(3));
+	}
+	if (cfg->stats)
+		draw_stats(1);
+}
+
+// Draw the `rows` of an entry starting at `line`, skipping over the others, and return the line after it.  Only a full
+// paint lays out the meters for `paint_meters`, other paints keep the lines of the last one.
+// caller should hold app-mutex
+static int draw_entry(const Config *cfg, Entry *ent, bool selected, int line, uint8_t rows, unsigned frame, bool full) {
+	struct line_expect __attribute__((cleanup(line_expect_check))) expect = {
+		.begin = line,
+		.end = &line,
+		.expected = expected_entry_lines(ent),
+	};
 
+	int width = COLS - 33;
+	int x = 32;
+	// a corked entry shows no level, its monitor may be shared with entries that are playing
+	Monitor *meter = ent->corked ? NULL : ent->monitor;
+	// volume control bars
+	if (!(rows & ROW_VOLUME)) {
+		line += ent->type == ENTRY_CARD ? 0 : (ent->volume_lock ? 1 : ent->channels);
+	} else if (ent->volume_lock && ent->channels > 0) {
+		move(line, 0);
+		clrtoeol();
+		move(line, 1);
+		if (selected) {
+			addstr(">");
+		}
+		pa_volume_t vol = pa_cvolume_avg(&ent->detail->volume);
+		char buf[30];
+		pa_sw_volume_snprint_dB(buf, sizeof(buf) - 1, vol);
+		double pct = vol / (double)PA_VOLUME_NORM;
+		addstr(buf);
+		printw(" (%.2lf)", pct);
+		draw_volume_bar(line++, x, width, vol);
+	} else {
+		for (uint8_t j = 0; j < ent->channels; j++) {
+			move(line, 0);
+			clrtoeol();
+			if (selected && app.selected_channel == j) {
+				mvaddstr(line, 1, ">");
+			}
+			const char *channel_name = pa_channel_position_to_pretty_string(ent->detail->channel_map.map[j]);
+			if (cfg->channel_meters && meter != NULL) {
+				// the name makes room for a small meter of the channel
+				mvprintw(line, 3, "%.14s", channel_name);
+				if (full) {
+					struct EntLine el = {.monitor = meter, .line = (uint32_t)line, .channel = j};
+					da_append(&entry_lines, el);
+				}
+				struct EntLine *el = entry_line(line, j);
+				if (el != NULL)
+					draw_meter(el, false, true);
+			} else {
+				mvaddstr(line, 3, channel_name);
+			}
+			draw_volume_bar(line++, x, width, ent->detail->volume.values[j]);
+		}
+	}
+
+	// peak volume bar
+	if (ent->type != ENTRY_CARD) {
+		if (full && meter != NULL) {
+			atomic_store(&meter->shown, frame);
+			struct EntLine el = {.monitor = meter, .line = (uint32_t)line, .channel = -1};
+			da_append(&entry_lines, el);
+		}
+		if (rows & ROW_METER) {
+			// empty while it has no monitor stream or is corked
+			struct EntLine *el = entry_line(line, -1);
+			if (el != NULL)
+				draw_meter(el, cfg->peak_hold_ms != 0, true);
+			else
+				draw_volume_bar(line, 1, COLS - 2, PA_VOLUME_MUTED);
+		}
+		line++;
+	}
+
+	if (!(rows & ROW_NAME))
+		return ++line;
+
+	// entry name
+	move(line, 0);
+	clrtoeol();
+	if (selected)
+		attron(A_STANDOUT);
+	mvaddstr(line, 1, ent->detail->title.text);
+	attroff(A_STANDOUT);
+	if (ent->volume_lock)
+		printw(" 🔒");
+	if (ent->muted)
+		printw(" 🔇");
+	if (ent->corked)
+		printw(" ⏸");
+	unsigned clips = 0;
+	if (ent->monitor != NULL) {
+		clips = atomic_load(&ent->monitor->clips);
+		ent->detail->clips_shown = clips;
+	}
+	if (clips > 0) {
+		attron(COLOR_PAIR(3));
+		printw(" clip %u", clips);
+		attroff(COLOR_PAIR(3));
+	}
+
+	// device/port/profile display
+	switch (ent->type) {
+	case ENTRY_SINKINPUT:
+	case ENTRY_SOURCEOUTPUT: {
+		// the device may have appeared since the last refresh
+		const Label *device = app_device_name(&app, ent->type, ent->detail->data.device.index);
+		int dev_width = device != NULL ? device->width : 0;
+		int max_name = COLS - 1 - dev_width - 4;
+		
+		x = getcurx(stdscr);
+		if(x < max_name) {
+			// TODO: color
+			attron(A_DIM);
+			printw("  %s", label_fit(&ent->detail->subtitle, max_name - x));
+			attroff(A_DIM);
+		}
+
+		if (device != NULL)
+			mvaddstr(line, COLS - 1 - dev_width, device->text);
+		break;
+	}
+	case ENTRY_CARD:
+	case ENTRY_SINK:
+	case ENTRY_SOURCE: {
+		if (ent->detail->data.ports.current == -1)
+			break;
+		const NameDesc *port = &ent->detail->data.ports.items[ent->detail->data.ports.current];
+		mvaddstr(line, COLS - 1 - port->width, port->description);
+		break;
+	}
+	default:
+		break;
+	}
+	return ++line;
+}
+
+// Lay out and paint the whole page, also marks the monitors on it as shown.  Only the entries on screen are touched,
+// the rows marked dirty below it are painted with everything else once they are scrolled to.
+// caller should hold app-mutex
+static void paint_full(const Config *cfg) {
+	app.scroll = compute_entry_scroll();
+	erase();
+	unsigned frame = atomic_fetch_add(&app.frame, 1) + 1;
+	draw_header(cfg);
+
+	Entries *page = app_page(&app);
+	int line = 1;
+	entry_lines.len = 0;
+	for (size_t i = app.scroll; i < page->len; i++) {
+		line++;
+		bool selected = app.selected_entry == (int)i;
+		if (line + 3 > LINES) {
+			assert(!selected || (int)i == app.scroll);
+			break;
+		}
+		line = draw_entry(cfg, &page->items[i], selected, line, ROW_VOLUME | ROW_METER | ROW_NAME, frame, true);
+		page->items[i].dirty = 0;
+	}
+}
+
+// Repaint the header and the dirty rows of the entries on screen, in the layout of the last full paint.
+// caller should hold app-mutex
+static void paint_rows(const Config *cfg) {
+	if (compute_entry_scroll() != app.scroll) {
+		paint_full(cfg);
+		return;
+	}
+	draw_header(cfg);
+
+	Entries *page = app_page(&app);
+	unsigned frame = atomic_load(&app.frame);
+	int line = 1;
+	for (size_t i = app.scroll; i < page->len; i++) {
+		line++;
+		Entry *ent = &page->items[i];
+		if (line + 3 > LINES)
+			break;
+		if (ent->dirty == 0)
+			line += expected_entry_lines(ent);
+		else
+			line = draw_entry(cfg, ent, app.selected_entry == (int)i, line, ent->dirty, frame, false);
+		ent->dirty = 0;
+	}
+}
+
+// The monitor callbacks only count clips, the name rows showing a changed count are flagged here, for the visible
+// entries of the page.
+// caller should hold app-mutex
+static void mark_clipped_entries(void) {
+	Entries *page = app_page(&app);
+	int line = 1;
+	for (size_t i = app.scroll; i < page->len; i++) {
+		line++;
+		Entry *ent = &page->items[i];
+		if (line + 3 > LINES)
+			break;
+		line += expected_entry_lines(ent);
+		if (ent->monitor != NULL && atomic_load(&ent->monitor->clips) != ent->detail->clips_shown)
+			app_entry_dirty(&app, ent, ROW_NAME);
+	}
+}
+
+// monitors outlive their entries until the next full paint, so the meters are read without app-mutex
+static void paint_meters(const Config *cfg) {
+	for (size_t i = 0; i < entry_lines.len; i++)
+		draw_meter(&entry_lines.items[i], cfg->peak_hold_ms != 0, false);
+}
+
+// Mutating actions are applied to the local entry and sent as commands without waiting for the server, see
+// `app_command_start`.
 // caller should hold mainloop and app-mutex
-// return false on failure
-static bool drain_input_queue(const Config *cfg) {
-	for (size_t i = 0; i < app.input_queue.len; i++) {
-		InputEvent evt = app.input_queue.items[i];
+static void drain_input_queue(const Config *cfg) {
+	InputEvent evt;
+	while (input_queue_pop(&app.input_queue, &evt)) {
 		Action act = cfg->keymap[evt.keycode];
+		if (output_stats.key_at == 0)
+			output_stats.key_at = evt.at;
+		if (app.status[0] != '\0') {
+			app.status[0] = '\0';
+			atomic_store(&app.should_update, true);
+		}
 		if (act.type == ACTION_QUIT) {
-			app.running = false;
+			atomic_store(&app.running, false);
 			continue;
 		}
 		if (act.type == ACTION_SELECT_TAB) {
 			app.entry_page = cfg->keymap[evt.keycode].data.tab;
 			app.selected_entry = 0;
 			app.selected_channel = 0;
+			// every tab's cache is kept current, the refresh only applies pending reorders before the repaint
 			atomic_store(&app.should_refresh, true);
+			atomic_store(&app.should_redraw, true);
 			continue;
 		}
+		if (act.type == ACTION_RESYNC) {
+			atomic_store(&app.should_resync, true);
+			atomic_store(&app.should_refresh, true);
+			continue;
+		}
+		// the remaining actions work on the selected entry
+		if (app_page(&app)->len == 0)
+			continue;
 		if (act.type == ACTION_DEVICE_NEXT || act.type == ACTION_DEVICE_PREV) {
-			Entry ent = app.entries.items[app.selected_entry];
+			Entry *selected = &app_page(&app)->items[app.selected_entry];
+			Entry ent = *selected;
 			int off = act.type == ACTION_DEVICE_NEXT ? 1 : -1;
 
 			switch (ent.type) {
 			case ENTRY_SINKINPUT:
 			case ENTRY_SOURCEOUTPUT: {
-				if (ent.data.device.index == PA_INVALID_INDEX)
+				if (ent.detail->data.device.index == PA_INVALID_INDEX)
 					break;
-				uint32_t device_list[512] = {0};
-				for (size_t i = 0; i < sizeof(device_list) / sizeof(*device_list); i++)
-					device_list[i] = PA_INVALID_INDEX;
-
-				uint32_t *end = device_list;
-				pa_operation *op;
-				pa_operation_state_t state;
-				if (ent.type == ENTRY_SINKINPUT)
-					op = pa_context_get_sink_info_list(app.pa_context, &collect_sink_indices, &end);
-				else
-					op = pa_context_get_source_info_list(app.pa_context, &collect_source_indices, &end);
-
-				assert(op != NULL);
-
-				RUN_OPERATION_OR_RETURN(op, state, false);
-				int device_count = (uintptr_t)(end - device_list);
-				assert((size_t)device_count <= sizeof(device_list) / sizeof(*device_list));
+				// the name cache already lists every sink/source, no need to ask the server
+				const DeviceNames *devices = ent.type == ENTRY_SINKINPUT ? &app.sink_names : &app.source_names;
+				int device_count = (int)devices->len;
 
 				int current_index = -1;
 				for (int i = 0; i < device_count; i++) {
-					if (ent.data.device.index != device_list[i])
+					if (ent.detail->data.device.index != devices->items[i].index)
 						continue;
 					current_index = i;
 					break;
 				}
-				assert(current_index >= 0);
+				if (current_index < 0)
+					break;
 
 				int idev = (current_index + off) % device_count;
 				if(idev == -1)
 					idev = device_count - 1;
 				assert(idev >= 0);
 				assert(idev < device_count);
-				uint32_t new_device = device_list[idev];
+				uint32_t new_device = devices->items[idev].index;
+				Command *cmd = app_command_new(&ent, "move stream", false);
+				pa_operation *op;
 				if (ent.type == ENTRY_SINKINPUT)
-					op = pa_context_move_sink_input_by_index(app.pa_context, ent.pa_index, new_device, &cb_success_signal, NULL);
+					op = pa_context_move_sink_input_by_index(app.pa_context, ent.pa_index, new_device, &app_command_done, cmd);
 				else
-					op = pa_context_move_source_output_by_index(app.pa_context, ent.pa_index, new_device, &cb_success_signal, NULL);
-				assert(op != NULL);
-				RUN_OPERATION_OR_RETURN(op, state, false);
+					op = pa_context_move_source_output_by_index(app.pa_context, ent.pa_index, new_device, &app_command_done, cmd);
+				app_command_start(&app, cmd, op);
+				selected->detail->data.device.index = new_device;
+				// the server's update then matches the local device, so the device sort key is flagged here
+				selected->reorder = true;
+				app_page(&app)->reorder = true;
+				atomic_store(&app.should_refresh, true);
 				break;
 			}
 			case ENTRY_SINK:
 			case ENTRY_SOURCE:
 			case ENTRY_CARD: {
-				if (ent.data.ports.current == -1)
+				if (ent.detail->data.ports.current == -1)
 					break;
-				assert((int)ent.data.ports.len > ent.data.ports.current);
-				int next = ((ent.data.ports.current + off) % ent.data.ports.len);
-				if (next == ent.data.ports.current) {
-					assert(ent.data.ports.len == 1);
+				assert((int)ent.detail->data.ports.len > ent.detail->data.ports.current);
+				int next = ((ent.detail->data.ports.current + off) % ent.detail->data.ports.len);
+				if (next == ent.detail->data.ports.current) {
+					assert(ent.detail->data.ports.len == 1);
 					break;
 				}
-				const char *name = ent.data.ports.items[next].name;
+				const char *name = ent.detail->data.ports.items[next].name;
 
 				pa_operation *op;
-				pa_operation_state_t state;
+				Command *cmd = app_command_new(&ent, ent.type == ENTRY_CARD ? "set profile" : "set port", false);
 				if (ent.type == ENTRY_SINK)
-					op = pa_context_set_sink_port_by_name(app.pa_context, ent.name, name, &cb_success_signal, NULL);
+					op = pa_context_set_sink_port_by_name(app.pa_context, ent.name, name, &app_command_done, cmd);
 				else if (ent.type == ENTRY_SOURCE)
-					op = pa_context_set_source_port_by_name(app.pa_context, ent.name, name, &cb_success_signal, NULL);
+					op = pa_context_set_source_port_by_name(app.pa_context, ent.name, name, &app_command_done, cmd);
 				else
-					op = pa_context_set_card_profile_by_name(app.pa_context, ent.name, name, &cb_success_signal, NULL);
-				assert(op != NULL);
-
-				RUN_OPERATION_OR_RETURN(op, state, false);
+					op = pa_context_set_card_profile_by_name(app.pa_context, ent.name, name, &app_command_done, cmd);
+				app_command_start(&app, cmd, op);
+				selected->detail->data.ports.current = next;
 			}
 			}
+			app_entry_dirty(&app, selected, ROW_NAME);
 			continue;
 		}
 		if (act.type == ACTION_ENTRY_NEXT || act.type == ACTION_ENTRY_PREV) {
 			int off = act.type == ACTION_ENTRY_NEXT ? 1 : -1;
-			bool entry_bounds = app.selected_entry + off < 0 || app.selected_entry + off >= (int)app.entries.len;
-			Entry ent = app.entries.items[app.selected_entry];
+			// the cursor is drawn in the volume rows, the selected name stands out
+			app_entry_dirty(&app, &app_page(&app)->items[app.selected_entry], ROW_VOLUME | ROW_NAME);
+			bool entry_bounds = app.selected_entry + off < 0 || app.selected_entry + off >= (int)app_page(&app)->len;
+			Entry ent = app_page(&app)->items[app.selected_entry];
 			if (ent.volume_lock && !entry_bounds) {
 				app.selected_entry += off;
-				Entry other = app.entries.items[app.selected_entry];
+				Entry other = app_page(&app)->items[app.selected_entry];
 				if (other.volume_lock)
 					app.selected_channel = 0;
 				else if (off < 0)
-					app.selected_channel = other.volume.channels - 1;
+					app.selected_channel = other.channels - 1;
 			} else {
-				if (off > 0 && ent.volume.channels > app.selected_channel + off) {
+				if (off > 0 && ent.channels > app.selected_channel + off) {
 					app.selected_channel += off;
 				} else if (off < 0 && app.selected_channel > 0) {
 					app.selected_channel += off;
 				} else if (!entry_bounds) {
 					app.selected_entry += off;
-					Entry other = app.entries.items[app.selected_entry];
+					Entry other = app_page(&app)->items[app.selected_entry];
 					if (other.volume_lock)
 						app.selected_channel = 0;
 					else if (off < 0)
-						app.selected_channel = other.volume.channels - 1;
+						app.selected_channel = other.channels - 1;
 				}
 			}
-			atomic_store(&app.should_refresh, true);
+			app_entry_dirty(&app, &app_page(&app)->items[app.selected_entry], ROW_VOLUME | ROW_NAME);
 			continue;
 		}
 		if (act.type == ACTION_LOCK_TOGGLE) {
-			Entry *ent = &app.entries.items[app.selected_entry];
-			if (ent->volume.channels == 0)
+			Entry *ent = &app_page(&app)->items[app.selected_entry];
+			if (ent->channels == 0)
 				continue;
 			ent->volume_lock = !ent->volume_lock;
+			entries_lines_changed(app_page(&app), app.selected_entry);
 			app.selected_channel = 0;
-			atomic_store(&app.should_refresh, true);
+			atomic_store(&app.should_redraw, true);
 			continue;
 		}
 		if (act.type == ACTION_MUTE_TOGGLE) {
-			Entry ent = app.entries.items[app.selected_entry];
-			pa_operation *op = entry_set_muted(ent, !ent.muted);
-			if (op == NULL)
+			Entry *ent = &app_page(&app)->items[app.selected_entry];
+			if (ent->type == ENTRY_CARD)
 				continue;
-			pa_operation_state_t state;
-			RUN_OPERATION_OR_RETURN(op, state, false);
+			Command *cmd = app_command_new(ent, "set mute", false);
+			app_command_start(&app, cmd, entry_set_muted(*ent, !ent->muted, cmd));
+			ent->muted = !ent->muted;
+			app_entry_dirty(&app, ent, ROW_NAME);
 			continue;
 		}
 		if (act.type == ACTION_VOLUME_SET || act.type == ACTION_VOLUME_ADD) {
-			Entry ent = app.entries.items[app.selected_entry];
-			if (ent.volume.channels == 0)
+			Entry ent = app_page(&app)->items[app.selected_entry];
+			if (ent.channels == 0)
 				continue;
+			pa_cvolume cvol = ent.detail->volume;
 			pa_volume_t newvol;
 			if (act.type == ACTION_VOLUME_SET) {
 				if (ent.volume_lock) {
 					newvol = (pa_volume_t)((float)PA_VOLUME_NORM * act.data.volume);
-					pa_cvolume_set(&ent.volume, ent.volume.channels, newvol);
+					pa_cvolume_set(&cvol, ent.channels, newvol);
 				} else {
-					assert(app.selected_channel >= 0 && app.selected_channel < ent.volume.channels);
-					ent.volume.values[app.selected_channel] = PA_VOLUME_NORM * act.data.volume;
+					assert(app.selected_channel >= 0 && app.selected_channel < ent.channels);
+					cvol.values[app.selected_channel] = PA_VOLUME_NORM * act.data.volume;
 				}
 			} else {
 				int64_t delta = PA_VOLUME_NORM * act.data.volume;
-				int64_t volume = (int64_t)(ent.volume_lock ? pa_cvolume_avg(&ent.volume) : ent.volume.values[app.selected_channel]);
+				int64_t volume = (int64_t)(ent.volume_lock ? pa_cvolume_avg(&cvol) : cvol.values[app.selected_channel]);
 				volume += delta;
 				if(volume < PA_VOLUME_MUTED)
 					volume = PA_VOLUME_MUTED;
 				else if(volume > (int)(PA_VOLUME_NORM * 1.5f))
 					volume = (int)(PA_VOLUME_NORM * 1.5f);
 				if (ent.volume_lock) {
-					pa_cvolume_set(&ent.volume, ent.volume.channels, volume);
+					pa_cvolume_set(&cvol, ent.channels, volume);
 				} else {
-					assert(app.selected_channel >= 0 && app.selected_channel < ent.volume.channels);
-					ent.volume.values[app.selected_channel] = volume;
+					assert(app.selected_channel >= 0 && app.selected_channel < ent.channels);
+					cvol.values[app.selected_channel] = volume;
 				}
 			}
 
-			pa_operation *op = entry_set_volume(ent, &ent.volume);
-			assert(op != NULL);
-			pa_operation_state_t state;
-			RUN_OPERATION_OR_RETURN(op, state, false);
-			atomic_store(&app.should_refresh, true);
+			// held keys queue many volume changes, only the final volume is sent by `flush_volume_changes`
+			Entry *selected = &app_page(&app)->items[app.selected_entry];
+			selected->detail->volume = cvol;
+			selected->volume_dirty = true;
+			app.volume_dirty = true;
+			volume_due = 0;
+			app_entry_dirty(&app, selected, ROW_VOLUME);
 			continue;
 		}
 	}
-	app.input_queue.len = 0;
+}
+
+// where the snapshot of `set snapshot` is kept
+static bool snapshot_path(char *path, size_t size) {
+	const char *home = getenv("HOME");
+	const char *xdg_cache_home = getenv("XDG_CACHE_HOME");
+	if (xdg_cache_home != NULL && xdg_cache_home[0] != '\0')
+		snprintf(path, size, "%s/pamix.snapshot", xdg_cache_home);
+	else if (home != NULL)
+		snprintf(path, size, "%s/.cache/pamix.snapshot", home);
+	else
+		return false;
 	return true;
 }
 
@@ -448,32 +985,51 @@ int main(void) {
 		config_default(&cfg);
 	} while(0);
 
-	pa_threaded_mainloop *mainloop = pa_threaded_mainloop_new();
-	assert(mainloop != NULL);
-
-	pa_threaded_mainloop_lock(mainloop);
-	if (pa_threaded_mainloop_start(mainloop) == -1) {
-		fprintf(stderr, "could not start mainloop\n");
-		return 1;
+	// the signalfd only sees SIGWINCH if no thread takes it, the mainloop thread inherits the mask
+	sigset_t winch;
+	sigemptyset(&winch);
+	sigaddset(&winch, SIGWINCH);
+	pthread_sigmask(SIG_BLOCK, &winch, NULL);
+
+	pa_threaded_mainloop *mainloop = NULL;
+	pa_mainloop *loop = NULL;
+	if (cfg.single_thread) {
+		loop = pa_mainloop_new();
+		assert(loop != NULL);
+	} else {
+		mainloop = pa_threaded_mainloop_new();
+		assert(mainloop != NULL);
+		if (pa_threaded_mainloop_start(mainloop) == -1) {
+			fprintf(stderr, "could not start mainloop\n");
+			return 1;
+		}
 	}
 
-	pa_threaded_mainloop_unlock(mainloop);
-
-	// we pass NULL as pa_context* and let the reconnect thread handle it
-	app_init(&app, NULL, mainloop);
+	// the context is created by `connect_context` once the screen is set up
+	app_init(&app, NULL, mainloop, loop);
+	app.sort_key = cfg.sort;
+	app.channel_meters = cfg.channel_meters;
+	monitor_set_hold(cfg.peak_hold_ms, cfg.peak_decay / 100.0f);
+	monitor_set_format(cfg.meter_rate, cfg.meter_fragment, cfg.meter_format);
+	output_budget.limit = cfg.output_budget;
+	atomic_store(&app.should_resync, true);
 	atomic_store(&app.should_refresh, true);
 	app.entry_page = ENTRY_SINKINPUT;
 
 	{
 		setlocale(LC_ALL, "");
 		initscr();
-		nodelay(stdscr, true);
 		set_escdelay(25);
 		curs_set(0);
-		keypad(stdscr, true);
 		meta(stdscr, true);
 		noecho();
 
+		input_win = newwin(1, 1, 0, 0);
+		nodelay(input_win, true);
+		keypad(input_win, true);
+		// get the initial refresh of the new window out of the way here, instead of in the first wgetch
+		wrefresh(input_win);
+
 		start_color();
 		int background = use_default_colors() ? 0 : -1;
 		init_pair(1, COLOR_GREEN, background);
@@ -481,262 +1037,181 @@ int main(void) {
 		init_pair(3, COLOR_RED, background);
 	}
 
-	signal(SIGWINCH, on_signal_resize);
-
-	struct EntLine {
-		uint32_t entry;
-		uint32_t line;
-	};
-	struct EntLines {
-		struct EntLine *items;
-		size_t len;
-		size_t cap;
-	};
-	struct EntLines entry_lines = {0};
-
-	pthread_t input_thread;
-	pthread_t reconnect_thread;
-	int pthread_status = pthread_create(&input_thread, NULL, &input_thread_main, NULL);
-	pthread_status |= pthread_create(&reconnect_thread, NULL, &reconnect_thread_main, NULL);
-	if(pthread_status != 0) {
-		fprintf(stderr, "failed to create threads\n");
-		exit(1);
+	// frames are painted at most every `frame_interval`, `next_frame` is the earliest time of the next one
+	pa_usec_t frame_interval = cfg.max_fps > 0 ? PA_USEC_PER_SEC / cfg.max_fps : 0;
+	pa_usec_t next_frame = 0;
+
+	app_lock(&app);
+	pa_mainloop_api *api = app_api(&app);
+	stdin_event = api->io_new(api, STDIN_FILENO, PA_IO_EVENT_INPUT, &on_stdin_ready, NULL);
+	assert(stdin_event != NULL);
+	int resize_fd = signalfd(-1, &winch, SFD_NONBLOCK | SFD_CLOEXEC);
+	assert(resize_fd >= 0);
+	pa_io_event *resize_event = api->io_new(api, resize_fd, PA_IO_EVENT_INPUT, &on_resize_signal, NULL);
+	assert(resize_event != NULL);
+	app_unlock(&app);
+
+	char cache_path[PATH_MAX];
+	// after setlocale, the labels measure their width
+	bool use_snapshot = cfg.snapshot && snapshot_path(cache_path, sizeof(cache_path));
+	if (use_snapshot) {
+		pthread_mutex_lock(&app.mutex);
+		app.provisional = snapshot_load(cache_path);
+		pthread_mutex_unlock(&app.mutex);
 	}
+	app_lock(&app);
+	jitter_state = (uint32_t)pa_rtclock_now() ^ (uint32_t)getpid() ^ 1;
+	connect_context();
+	app_unlock(&app);
 
-	while (app.running) {
+	while (atomic_load(&app.running)) {
 		{
-			pa_threaded_mainloop_lock(mainloop);
+			app_lock(&app);
 			pthread_mutex_lock(&app.mutex);
+			read_keys();
 
 			if(app.pa_context == NULL || pa_context_get_state(app.pa_context) != PA_CONTEXT_READY) {
-				erase();
-				mvprintw(0, 0, "Waiting for PulseAudio connection...");
-				refresh();
-				for(size_t i = 0; i < app.input_queue.len; i++) {
-					Action action = cfg.keymap[app.input_queue.items[i].keycode];
+				if (app.provisional) {
+					// the last known state, until the server answers
+					snprintf(app.status, sizeof(app.status), "Waiting for PulseAudio connection...");
+					paint_full(&cfg);
+				} else {
+					erase();
+					mvprintw(0, 0, "Waiting for PulseAudio connection...");
+				}
+				present();
+				InputEvent evt;
+				while(input_queue_pop(&app.input_queue, &evt)) {
+					Action action = cfg.keymap[evt.keycode];
 					if(action.type == ACTION_QUIT) {
-						app.running = false;
+						atomic_store(&app.running, false);
 						break;
 					}
 				}
-				if(!app.running) {
+				if(!atomic_load(&app.running)) {
 					pthread_mutex_unlock(&app.mutex);
-					pa_threaded_mainloop_unlock(app.pa_mainloop);
+					app_unlock(&app);
 					break;
 				}
-				app.input_queue.len = 0;
 				pthread_mutex_unlock(&app.mutex);
-				pa_threaded_mainloop_wait(app.pa_mainloop);
-				pa_threaded_mainloop_unlock(app.pa_mainloop);
+				app_wait(&app);
+				app_unlock(&app);
 				continue;
 			}
 
-			bool ok = drain_input_queue(&cfg);
-			if(!ok) {
-				pthread_mutex_unlock(&app.mutex);
-				pa_threaded_mainloop_unlock(app.pa_mainloop);
-				continue;
-			}
+			app_reap_commands(&app);
+			drain_input_queue(&cfg);
 
 			pthread_mutex_unlock(&app.mutex);
-			pa_threaded_mainloop_unlock(mainloop);
+			app_unlock(&app);
 		}
 		if (atomic_exchange(&app.resized, false)) {
-			pthread_mutex_lock(&app.mutex);
 			endwin();
 			refresh();
-			pthread_mutex_unlock(&app.mutex);
-			atomic_store(&app.should_refresh, true);
+			atomic_store(&app.should_redraw, true);
 		}
-		if (atomic_exchange(&app.should_refresh, false)) {
-			bool ok = app_refresh_entries(&app);
-			if(!ok) {
+		// A frame merges everything that changed since the previous one, at most `max_fps` times per second.  Layout
+		// changes repaint everything, other changes only the rows of the entries they touched.
+		pa_usec_t now = pa_rtclock_now();
+		bool frame_due = now >= next_frame;
+		if (frame_due && frame_pending()) {
+			next_frame = now + frame_interval;
+			// refresh reconciles entries with the server (ordering, device names, monitors)
+			if (atomic_exchange(&app.should_refresh, false) && !app_refresh_entries(&app))
 				continue;
+			if (app.volume_dirty) {
+				app_lock(&app);
+				pthread_mutex_lock(&app.mutex);
+				flush_volume_changes(&cfg);
+				pthread_mutex_unlock(&app.mutex);
+				app_unlock(&app);
 			}
-			pthread_mutex_lock(&app.mutex);
-			app.scroll = compute_entry_scroll();
-			erase();
-
-			const char *entry_type_names[] = {"Playback", "Recording", "Output Devices", "Input Devices", "Cards"};
-			move(0, 1);
-			printw("%d/%zu", app.selected_entry + 1, app.entries.len);
-			mvaddstr(0, 10, entry_type_names[app.entry_page]);
-
-			int line = 1;
-			entry_lines.len = 0;
-			for (size_t i = app.scroll; i < app.entries.len; i++) {
-				line++;
-				Entry *ent = &app.entries.items[i];
-
-				bool selected = app.selected_entry == (int)i;
-				int entsize = 1;
-				if (line + entsize + 2 > LINES) {
-					assert(!selected || (int)i == app.scroll);
-					break;
-				}
-
-				struct line_expect __attribute__((cleanup(line_expect_check))) expect = {
-					.begin = line,
-					.end = &line,
-					.expected = expected_entry_lines(ent),
-				};
-
-				int width = COLS - 33;
-				int x = 32;
-				// volume control bars
-				if (ent->volume_lock && ent->volume.channels > 0) {
-					move(line, 1);
-					if (app.selected_entry == (int)i) {
-						addstr(">");
-					}
-					pa_volume_t vol = pa_cvolume_avg(&ent->volume);
-					char buf[30];
-					pa_sw_volume_snprint_dB(buf, sizeof(buf) - 1, vol);
-					double pct = vol / (double)PA_VOLUME_NORM;
-					addstr(buf);
-					printw(" (%.2lf)", pct);
-					draw_volume_bar(line++, x, width, vol);
-				} else {
-					for (uint8_t j = 0; j < ent->volume.channels; j++) {
-						if (app.selected_entry == (int)i && app.selected_channel == j) {
-							mvaddstr(line, 1, ">");
-						}
-						const char *channel_name = pa_channel_position_to_pretty_string(ent->channel_map.map[j]);
-						mvaddstr(line, 3, channel_name);
-						draw_volume_bar(line++, x, width, ent->volume.values[j]);
-					}
-				}
-
-				// peak volume bar
-				if(ent->type != ENTRY_CARD) {
-					pa_volume_t peak = ent->peak * PA_VOLUME_NORM;
-					if (ent->monitor_stream == NULL)
-						peak = PA_VOLUME_MUTED;
-					struct EntLine el = {.entry = ent->pa_index, .line = (uint32_t)line};
-					da_append(&entry_lines, el);
-					draw_volume_bar(line++, 1, COLS - 2, peak);
-				}
-
-				// entry name
-				if (selected)
-					attron(A_STANDOUT);
-				switch (ent->type) {
-				case ENTRY_SINKINPUT:
-					mvaddstr(line, 1, pa_proplist_gets(ent->props, PA_PROP_APPLICATION_NAME));
-					break;
-				case ENTRY_SINK:
-				case ENTRY_SOURCE:
-					mvaddstr(line, 1, pa_proplist_gets(ent->props, PA_PROP_DEVICE_DESCRIPTION));
-					printw(" %s", pa_proplist_gets(ent->props, PA_PROP_DEVICE_PROFILE_DESCRIPTION));
-					break;
-				case ENTRY_CARD:
-					mvaddstr(line, 1, pa_proplist_gets(ent->props, PA_PROP_DEVICE_DESCRIPTION));
-					break;
-				default:
-					mvaddstr(line, 1, ent->name);
-					break;
-				}
-				attroff(A_STANDOUT);
-				if (ent->volume_lock)
-					printw(" 🔒");
-				if (ent->muted)
-					printw(" 🔇");
-				if (ent->corked)
-					printw(" ⏸");
-
-				// device/port/profile display
-				switch (ent->type) {
-				case ENTRY_SINKINPUT:
-				case ENTRY_SOURCEOUTPUT: {
-					char buf[256];
-					int dev_len = 0;
-					assert(ent->data.device.name != NULL);
-					if (ent->data.device.name != NULL)
-						dev_len = snprintf(buf, sizeof(buf) - 1, "%s", ent->data.device.name);
-
-					int name_len = strlen(ent->name);
-					int max_name = COLS - 1 - dev_len - 4;
-					
-					x = getcurx(stdscr);
-					if(x < max_name) {
-						// TODO: color
-						attron(A_DIM);
-						if(name_len > max_name - x) {
-							printw("  %.*s...", max_name - x - 3, ent->name);
-						} else {
-							printw("  %s", ent->name);
-						}
-						attroff(A_DIM);
-					}
-
-					mvaddstr(line, COLS - 1 - dev_len, buf);
-					break;
-				}
-				case ENTRY_CARD:
-				case ENTRY_SINK:
-				case ENTRY_SOURCE: {
-					char buf[256];
-					int len;
-					len = sprintf(buf, "%s", ent->data.ports.items[ent->data.ports.current].description);
-					mvaddstr(line, COLS - 1 - len, buf);
-					break;
-				}
-				default:
-					break;
-				}
-				line++;
+			if (atomic_load(&app.new_peaks)) {
+				pthread_mutex_lock(&app.mutex);
+				mark_clipped_entries();
+				pthread_mutex_unlock(&app.mutex);
 			}
-			refresh();
-			pthread_mutex_unlock(&app.mutex);
-		} else if (app.new_peaks) {
-			pthread_mutex_lock(&app.mutex);
-			app.new_peaks = false;
-			for (size_t i = 0; i < entry_lines.len; i++) {
-				struct EntLine el = entry_lines.items[i];
-				Entry *ent = NULL;
-				for (size_t j = 0; j < app.entries.len; j++) {
-					Entry *e = &app.entries.items[j];
-					if (e->pa_index == el.entry) {
-						ent = e;
-						break;
-					}
-				}
-				assert(ent != NULL);
-				pa_volume_t peak = ent->peak * PA_VOLUME_NORM;
-				if (ent->monitor_stream == NULL)
-					peak = PA_VOLUME_MUTED;
-				draw_volume_bar(el.line, 1, COLS - 2, peak);
+			if (atomic_exchange(&app.should_redraw, false)) {
+				atomic_store(&app.should_update, false);
+				pthread_mutex_lock(&app.mutex);
+				paint_full(&cfg);
+				pthread_mutex_unlock(&app.mutex);
+			} else if (atomic_exchange(&app.should_update, false)) {
+				pthread_mutex_lock(&app.mutex);
+				paint_rows(&cfg);
+				pthread_mutex_unlock(&app.mutex);
 			}
-			refresh();
-			pthread_mutex_unlock(&app.mutex);
+			// over budget the meters wait for a later frame, volumes and layout always go out
+			if (atomic_exchange(&app.new_peaks, false)) {
+				if (output_budget_allows())
+					paint_meters(&cfg);
+				else
+					output_budget.dropped++;
+			}
+			present();
+			// without a cap the next frame is due right away
+			frame_due = frame_interval == 0;
 		}
 
-		if (!app.running)
+		if (!atomic_load(&app.running))
 			break;
-		pa_threaded_mainloop_lock(mainloop);
-		if (atomic_load(&app.should_refresh) || app.new_peaks || app.input_queue.len > 0) {
-			pa_threaded_mainloop_unlock(mainloop);
+		app_lock(&app);
+		if (!input_queue_empty(&app.input_queue) || atomic_load(&stdin_ready) != 0 || (frame_due && frame_pending())) {
+			app_unlock(&app);
 			continue;
 		}
-		pa_threaded_mainloop_wait(app.pa_mainloop);
-		pa_threaded_mainloop_unlock(mainloop);
+		// changes that arrived during or right after the last frame wait for the next one
+		if (frame_pending())
+			schedule_wakeup(next_frame > now ? next_frame - now : 0);
+		else
+			// the keys since the last frame changed nothing, they aren't measured
+			output_stats.key_at = 0;
+		app_wait(&app);
+		app_unlock(&app);
 	}
 
-	pthread_join(input_thread, NULL);
-	pthread_cancel(reconnect_thread);
-	pthread_join(reconnect_thread, NULL);
+	app_lock(&app);
+	// entries the server hasn't confirmed yet, like the leftovers of the loaded snapshot, are not saved as current
+	if (use_snapshot && app.synced && app.pa_context != NULL &&
+	    pa_context_get_state(app.pa_context) == PA_CONTEXT_READY) {
+		pthread_mutex_lock(&app.mutex);
+		snapshot_save(cache_path);
+		pthread_mutex_unlock(&app.mutex);
+	}
+	api->io_free(stdin_event);
+	api->io_free(resize_event);
+	if (wakeup_event != NULL)
+		api->time_free(wakeup_event);
+	if (reconnect_event != NULL)
+		api->time_free(reconnect_event);
+	// the monitor streams are closed while their context and mainloop still exist
+	for(size_t t = 0; t <= ENTRY_CARD; t++) {
+		for(size_t i = 0; i < app.entries[t].len; i++) {
+			entry_free(&app.entries[t].items[i]);
+		}
+		entries_free(&app.entries[t]);
+	}
+	monitors_free();
+	app_unlock(&app);
 
 	if(entry_lines.cap != 0)
 		free(entry_lines.items);
-	if(app.pa_context != NULL && PA_CONTEXT_IS_GOOD(pa_context_get_state(app.pa_context))){
-		pa_context_disconnect(app.pa_context);
+	// a failed or never connected context still leaves the mainloop to free
+	if (app.pa_mainloop != NULL)
 		pa_threaded_mainloop_stop(app.pa_mainloop);
-		pa_threaded_mainloop_free(app.pa_mainloop);
-	}
-	for(size_t i = 0; i < app.entries.len; i++) {
-		entry_free(&app.entries.items[i]);
+	if (app.pa_context != NULL) {
+		pa_context_set_state_callback(app.pa_context, NULL, NULL);
+		if (PA_CONTEXT_IS_GOOD(pa_context_get_state(app.pa_context)))
+			pa_context_disconnect(app.pa_context);
+		pa_context_unref(app.pa_context);
 	}
+	if (app.pa_mainloop != NULL)
+		pa_threaded_mainloop_free(app.pa_mainloop);
+	else
+		pa_mainloop_free(app.pa_loop);
+	close(resize_fd);
 
+	delwin(input_win);
 	endwin();
 	return 0;
 }
@@ -748,25 +1223,16 @@ int compute_entry_scroll(void) {
 	if (scroll > app.selected_entry)
 		return app.selected_entry;
 
-	int entry_sizes[app.entries.len];
-	for (size_t i = 0; i < app.entries.len; i++) {
-		entry_sizes[i] = expected_entry_lines(&app.entries.items[i]);
-	}
-
-	int line = 2;
-	for (size_t i = scroll; i < app.entries.len; i++) {
-		line += entry_sizes[i] + 1;
-		if ((int)i < scroll || app.selected_entry != (int)i)
-			continue;
-		if (line > LINES) {
-			int backscroll = 0;
-			size_t j = scroll;
-			for (; j < i && line - backscroll > LINES; j++)
-				backscroll += entry_sizes[j];
-			scroll = (int)j;
-		}
-		break;
-	}
-
-	return scroll;
+	const Entries *page = app_page(&app);
+	if ((size_t)app.selected_entry >= page->len)
+		return scroll;
+	// the entries are drawn from line 2, the selected one has to end on screen
+	int end = entries_lines_before(page, app.selected_entry + 1);
+	if (2 + end - entries_lines_before(page, scroll) <= LINES)
+		return scroll;
+	// the first scroll that leaves out at least `overflow` lines above, or the selected entry if it is taller than
+	// the screen
+	int overflow = end - (LINES - 2);
+	int first = (int)entries_fit(page, overflow - 1) + 1;
+	return first < app.selected_entry ? first : app.selected_entry;
 }
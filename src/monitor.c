@@ -0,0 +1,360 @@
+#include "monitor.h"
+#include "app.h"
+#include "da.h"
+#include "scan.h"
+#include <assert.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+// Monitors are keyed by (kind, index), so a sink, its monitor source and the recording streams of that source all
+// share one stream, and entries of hidden tabs keep theirs alive.  Released monitors stay connected but corked in a
+// small pool, so an entry that comes back (a stream uncorking, a device reappearing) reuses the connection.
+
+#define MONITOR_POOL_SIZE 8
+
+typedef struct {
+	Monitor **items;
+	size_t len;
+	size_t cap;
+} Monitors;
+
+_Static_assert(SCAN_CHANNELS_MAX >= PA_CHANNELS_MAX, "the scanners must take every channel of a stream");
+
+static Monitors monitors;
+// destroyed monitors, reused by `monitor_acquire`
+static Monitors recycled;
+
+static uint64_t release_seq;
+
+static pa_usec_t hold_time;
+static float hold_decay;
+
+static pa_sample_spec meter_spec = {.rate = 40, .format = PA_SAMPLE_FLOAT32NE, .channels = 1};
+// samples per fragment, each fragment is one read callback
+static uint32_t meter_fragment = 1;
+
+static struct {
+	atomic_size_t streams;
+	atomic_size_t pooled;
+	atomic_size_t created;
+	atomic_size_t destroyed;
+	atomic_size_t reused;
+} stats;
+
+static void cb_closing_state(pa_stream *stream, void *data);
+
+// Tear down a stream in whatever state it is in.  Streams still being created can't be disconnected before the server
+// confirmed them, those finish in `cb_closing_state`.
+static void stream_close(pa_stream *stream) {
+	pa_stream_set_read_callback(stream, NULL, NULL);
+	switch (pa_stream_get_state(stream)) {
+	case PA_STREAM_CREATING:
+		pa_stream_set_state_callback(stream, &cb_closing_state, NULL);
+		return;
+	case PA_STREAM_READY:
+		pa_stream_set_state_callback(stream, NULL, NULL);
+		pa_stream_disconnect(stream);
+		break;
+	default:
+		pa_stream_set_state_callback(stream, NULL, NULL);
+		break;
+	}
+	pa_stream_unref(stream);
+	atomic_fetch_add(&stats.destroyed, 1);
+}
+
+static void cb_closing_state(pa_stream *stream, void *data) {
+	(void)data;
+	if (pa_stream_get_state(stream) != PA_STREAM_CREATING)
+		stream_close(stream);
+}
+
+static void stream_cork(pa_stream *stream, bool cork) {
+	if (pa_stream_get_state(stream) != PA_STREAM_READY)
+		return;
+	pa_operation *op = pa_stream_cork(stream, cork, NULL, NULL);
+	if (op != NULL)
+		pa_operation_unref(op);
+}
+
+static void monitor_destroy(size_t i) {
+	Monitor *mon = monitors.items[i];
+	assert(mon->refs == 0);
+	if (mon->stream != NULL) {
+		stream_close(mon->stream);
+		atomic_fetch_sub(&stats.streams, 1);
+	}
+	atomic_fetch_sub(&stats.pooled, 1);
+	monitors.items[i] = monitors.items[--monitors.len];
+	// the renderer may still read it until the next full paint
+	monitor_store_peak(mon, -1);
+	da_append(&recycled, mon);
+}
+
+static size_t monitor_position(const Monitor *mon) {
+	for (size_t i = 0; i < monitors.len; i++) {
+		if (monitors.items[i] == mon)
+			return i;
+	}
+	assert(0 && "unknown monitor");
+	__builtin_unreachable();
+}
+
+static void scan_fragment(const void *data, size_t frames, unsigned channels, float *ch_max, float *sumsq) {
+	switch (meter_spec.format) {
+	case PA_SAMPLE_S16NE:
+		scan_s16(data, frames, channels, ch_max, sumsq);
+		break;
+	case PA_SAMPLE_U8:
+		scan_u8(data, frames, channels, ch_max, sumsq);
+		break;
+	default:
+		scan_float32(data, frames, channels, ch_max, sumsq);
+		break;
+	}
+}
+
+// applies to streams connected afterwards
+void monitor_set_format(unsigned rate, unsigned fragment, meter_format format) {
+	assert(rate > 0 && fragment > 0);
+	meter_spec.rate = rate;
+	meter_fragment = fragment;
+	switch (format) {
+	case METER_FLOAT32:
+		meter_spec.format = PA_SAMPLE_FLOAT32NE;
+		break;
+	case METER_S16:
+		meter_spec.format = PA_SAMPLE_S16NE;
+		break;
+	case METER_U8:
+		meter_spec.format = PA_SAMPLE_U8;
+		break;
+	}
+}
+
+void monitor_set_hold(unsigned hold_ms, float decay) {
+	hold_time = (pa_usec_t)hold_ms * PA_USEC_PER_MSEC;
+	hold_decay = decay;
+}
+
+// keep the highest recent peak for `hold_time`, then let it fall towards the current peak
+static void update_hold(Monitor *mon, float peak) {
+	if (hold_time == 0)
+		return;
+	pa_usec_t now = pa_rtclock_now();
+	if (peak >= monitor_hold(mon)) {
+		mon->hold_top = peak;
+		mon->hold_since = now;
+		float_store(&mon->hold, peak);
+		return;
+	}
+	pa_usec_t held = now - mon->hold_since;
+	if (held < hold_time)
+		return;
+	float hold = mon->hold_top - hold_decay * (float)(held - hold_time) / PA_USEC_PER_SEC;
+	float_store(&mon->hold, hold_decay > 0 && hold > peak ? hold : peak);
+}
+
+static void cb_monitor_read(pa_stream *stream, size_t nbytes, void *pdata) {
+	Monitor *mon = pdata;
+	const void *data;
+	int err = pa_stream_peek(stream, &data, &nbytes);
+	if (err != 0) {
+		return;
+	}
+	// holes have no data but still need to be dropped
+	if (data == NULL) {
+		if (nbytes > 0)
+			pa_stream_drop(stream);
+		return;
+	}
+	size_t frame_size = pa_sample_size(&meter_spec) * mon->channels;
+	assert(nbytes >= frame_size);
+	assert((nbytes % frame_size) == 0);
+	// the whole fragment, so short transients between two reads aren't lost
+	size_t frames = nbytes / frame_size;
+	float ch_max[PA_CHANNELS_MAX];
+	float sumsq;
+	scan_fragment(data, frames, mon->channels, ch_max, &sumsq);
+	float peak = 0;
+	for (unsigned c = 0; c < mon->channels; c++) {
+		peak = fmaxf(peak, ch_max[c]);
+		float_store(&mon->channel_peaks[c], ch_max[c]);
+	}
+
+	pa_stream_drop(stream);
+
+	if (mon->refs == 0)
+		return;
+	if (peak >= 1.0f)
+		atomic_fetch_add(&mon->clips, 1);
+	update_hold(mon, peak);
+	app_monitor_peak(mon, peak, sqrtf(sumsq / (frames * mon->channels)));
+}
+
+static void cb_monitor_state(pa_stream *stream, void *data) {
+	Monitor *mon = data;
+	pa_stream_state_t state = pa_stream_get_state(stream);
+	if (state == PA_STREAM_READY) {
+		// released while it was being created
+		if (mon->refs == 0)
+			stream_cork(stream, true);
+		return;
+	}
+	if (state != PA_STREAM_FAILED && state != PA_STREAM_TERMINATED)
+		return;
+
+	monitor_store_peak(mon, -1);
+	app_monitor_peak(mon, -1, 0);
+	mon->stream = NULL;
+	stream_close(stream);
+	atomic_fetch_sub(&stats.streams, 1);
+	if (mon->refs == 0)
+		monitor_destroy(monitor_position(mon));
+}
+
+// a map in `mon` selects per-channel peaks, an empty one a single peak of the downmix
+static pa_stream *monitor_connect(pa_context *ctx, Monitor *mon) {
+	const pa_channel_map *map = mon->map.channels > 0 ? &mon->map : NULL;
+	char stream_name[32];
+	snprintf(stream_name, sizeof(stream_name) - 1, "PeakMonitor %u", mon->index);
+
+	pa_sample_spec spec = meter_spec;
+	if (map != NULL)
+		spec.channels = map->channels;
+	mon->channels = spec.channels;
+	for (size_t c = 0; c < PA_CHANNELS_MAX; c++)
+		float_store(&mon->channel_peaks[c], 0);
+
+	pa_proplist *props = pa_proplist_new();
+	// hide monitor stream from pavucontrol
+	pa_proplist_sets(props, PA_PROP_APPLICATION_ID, "org.PulseAudio.pavucontrol");
+	pa_stream *stream = pa_stream_new_with_proplist(ctx, stream_name, &spec, map, props);
+	pa_proplist_free(props);
+	assert(stream != NULL);
+
+	char devname[16];
+	if (mon->kind == MONITOR_SINKINPUT) {
+		int err = pa_stream_set_monitor_stream(stream, mon->index);
+		if (err != 0) {
+			pa_stream_unref(stream);
+			return NULL;
+		}
+	} else {
+		sprintf(devname, "%u", mon->index);
+	}
+
+	pa_stream_set_read_callback(stream, &cb_monitor_read, mon);
+	pa_stream_set_state_callback(stream, &cb_monitor_state, mon);
+
+	pa_stream_flags_t flags = (pa_stream_flags_t)(PA_STREAM_DONT_MOVE | PA_STREAM_PEAK_DETECT | PA_STREAM_ADJUST_LATENCY);
+	uint32_t fragsize = meter_fragment * pa_frame_size(&spec);
+	// room for a few fragments, so a busy mainloop drops old peaks instead of growing latency
+	pa_buffer_attr bufattr = {.maxlength = fragsize * 4 > 128 ? fragsize * 4 : 128, .fragsize = fragsize};
+	int err = pa_stream_connect_record(stream, mon->kind == MONITOR_SINKINPUT ? NULL : devname, &bufattr, flags);
+	if (err != 0) {
+		pa_stream_set_read_callback(stream, NULL, NULL);
+		pa_stream_set_state_callback(stream, NULL, NULL);
+		pa_stream_unref(stream);
+		return NULL;
+	}
+
+	atomic_fetch_add(&stats.created, 1);
+	atomic_fetch_add(&stats.streams, 1);
+	return stream;
+}
+
+// Take a reference to the monitor of (kind, index) metering the channels of `map`, or a single downmixed channel for
+// NULL, reusing a live or pooled one when possible.  A monitor whose stream failed is reconnected, so callers retry by
+// acquiring again.
+// caller should hold mainloop and app-mutex
+Monitor *monitor_acquire(pa_context *ctx, monitor_kind kind, uint32_t index, const pa_channel_map *map) {
+	Monitor *mon = NULL;
+	for (size_t i = 0; i < monitors.len; i++) {
+		if (monitor_matches(monitors.items[i], kind, index, map)) {
+			mon = monitors.items[i];
+			break;
+		}
+	}
+
+	if (mon == NULL) {
+		if (recycled.len > 0) {
+			mon = recycled.items[--recycled.len];
+		} else {
+			mon = malloc(sizeof(*mon));
+			assert(mon != NULL);
+		}
+		*mon = (Monitor){.kind = kind, .index = index};
+		if (map != NULL)
+			mon->map = *map;
+		monitor_store_peak(mon, -1);
+		da_append(&monitors, mon);
+	} else if (mon->refs == 0) {
+		atomic_fetch_sub(&stats.pooled, 1);
+		if (mon->stream != NULL) {
+			stream_cork(mon->stream, false);
+			atomic_fetch_add(&stats.reused, 1);
+		}
+	}
+	mon->refs++;
+
+	if (mon->stream == NULL) {
+		mon->stream = monitor_connect(ctx, mon);
+		if (mon->stream != NULL)
+			monitor_store_peak(mon, 0);
+	}
+	return mon;
+}
+
+// Drop a reference, the last one moves the monitor to the pool, which evicts its least recently released monitor
+// once it is full.
+// caller should hold mainloop and app-mutex
+void monitor_release(Monitor *mon) {
+	assert(mon->refs > 0);
+	if (--mon->refs > 0)
+		return;
+	mon->released = ++release_seq;
+	if (mon->stream != NULL)
+		monitor_store_peak(mon, 0);
+	atomic_store(&mon->active, false);
+	atomic_fetch_add(&stats.pooled, 1);
+	if (mon->stream == NULL) {
+		monitor_destroy(monitor_position(mon));
+		return;
+	}
+	stream_cork(mon->stream, true);
+
+	if (atomic_load(&stats.pooled) <= MONITOR_POOL_SIZE)
+		return;
+	size_t oldest = monitors.len;
+	for (size_t i = 0; i < monitors.len; i++) {
+		if (monitors.items[i]->refs == 0 && (oldest == monitors.len || monitors.items[i]->released < monitors.items[oldest]->released))
+			oldest = i;
+	}
+	monitor_destroy(oldest);
+}
+
+// close every stream, all references must have been released
+// caller should hold mainloop
+void monitors_free(void) {
+	while (monitors.len > 0)
+		monitor_destroy(monitors.len - 1);
+	for (size_t i = 0; i < recycled.len; i++)
+		free(recycled.items[i]);
+	free(monitors.items);
+	free(recycled.items);
+	monitors = (Monitors){0};
+	recycled = (Monitors){0};
+}
+
+MonitorStats monitor_stats(void) {
+	return (MonitorStats){
+		.streams = atomic_load(&stats.streams),
+		.pooled = atomic_load(&stats.pooled),
+		.created = atomic_load(&stats.created),
+		.destroyed = atomic_load(&stats.destroyed),
+		.reused = atomic_load(&stats.reused),
+	};
+}
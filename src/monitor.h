@@ -0,0 +1,119 @@
+#ifndef _MONITOR_H
+#define _MONITOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pulse/pulseaudio.h>
+
+typedef enum {
+	// a single sink input, by its index
+	MONITOR_SINKINPUT,
+	// a source or the monitor source of a sink, by the source index
+	MONITOR_SOURCE,
+} monitor_kind;
+
+// sample format of the monitor streams, see `set meter-format`
+typedef enum {
+	METER_FLOAT32 = 0,
+	METER_S16,
+	METER_U8,
+} meter_format;
+
+// A peak-detection record stream, shared by all entries showing the same sink input or source with the same channel
+// map, see `monitor_matches`.  Monitors are owned by
+// the manager in monitor.c, entries only hold references.  Their memory is recycled but never freed before exit, so
+// the renderer may keep pointers across frames and read the peak without any lock.
+typedef struct {
+	monitor_kind kind;
+	uint32_t index;
+	// channels metered separately, none for the single peak of the downmix
+	pa_channel_map map;
+	// NULL while the stream failed, until it is reconnected by `monitor_acquire`
+	pa_stream *stream;
+	// entries holding this monitor, unreferenced monitors wait corked in the pool
+	unsigned refs;
+	// pool order, the least recently released monitor is dropped first
+	uint64_t released;
+	// bits of the last peak as float, negative while there is no stream, see `monitor_peak`
+	atomic_uint peak;
+	// bits of the held peak as float, see `set peak-hold`
+	atomic_uint hold;
+	// fragments that reached full scale
+	atomic_uint clips;
+	// channels of the stream, its peaks are also stored per channel in the entry's channel order
+	uint8_t channels;
+	atomic_uint channel_peaks[PA_CHANNELS_MAX];
+	// peak-hold state, only used on the mainloop thread
+	float hold_top;
+	pa_usec_t hold_since;
+	// `App.frame` of the last paint that showed this monitor
+	atomic_uint shown;
+	// the level is above silence, entries sort by their copy in `Entry.active`
+	atomic_bool active;
+} Monitor;
+
+typedef struct {
+	// monitors with a stream, including pooled ones
+	size_t streams;
+	size_t pooled;
+	// totals since start
+	size_t created;
+	size_t destroyed;
+	size_t reused;
+} MonitorStats;
+
+static inline float float_load(const atomic_uint *slot) {
+	unsigned bits = atomic_load_explicit(slot, memory_order_relaxed);
+	float value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+static inline void float_store(atomic_uint *slot, float value) {
+	unsigned bits;
+	memcpy(&bits, &value, sizeof(bits));
+	atomic_store_explicit(slot, bits, memory_order_relaxed);
+}
+
+static inline float monitor_peak(const Monitor *mon) {
+	return float_load(&mon->peak);
+}
+
+static inline float monitor_hold(const Monitor *mon) {
+	return float_load(&mon->hold);
+}
+
+static inline float monitor_channel_peak(const Monitor *mon, unsigned channel) {
+	return float_load(&mon->channel_peaks[channel]);
+}
+
+static inline void monitor_store_peak(Monitor *mon, float peak) {
+	float_store(&mon->peak, peak);
+	float_store(&mon->hold, peak);
+}
+
+// whether `mon` meters (kind, index) with the channels of `map`, NULL for the downmix
+static inline bool monitor_matches(const Monitor *mon, monitor_kind kind, uint32_t index, const pa_channel_map *map) {
+	if (mon->kind != kind || mon->index != index)
+		return false;
+	if (map == NULL)
+		return mon->map.channels == 0;
+	return pa_channel_map_equal(&mon->map, map);
+}
+
+// how long a peak is held before it falls by `decay` of full scale per second, a zero `hold` disables peak-hold
+void monitor_set_hold(unsigned hold_ms, float decay);
+// `rate` peaks per second are delivered `fragment` at a time
+void monitor_set_format(unsigned rate, unsigned fragment, meter_format format);
+
+// monitors are only created, released and torn down with the mainloop lock held, these take it as given
+Monitor *monitor_acquire(pa_context *ctx, monitor_kind kind, uint32_t index, const pa_channel_map *map);
+void monitor_release(Monitor *mon);
+void monitors_free(void);
+
+// safe to call without any lock
+MonitorStats monitor_stats(void);
+
+#endif
@@ -0,0 +1,101 @@
+#include "scan.h"
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+void scan_float32_scalar(const float *samples, size_t frames, unsigned channels, float *ch_max, float *sumsq) {
+	float s = 0;
+	for (unsigned c = 0; c < channels; c++)
+		ch_max[c] = 0;
+	for (size_t i = 0; i < frames * channels; i++) {
+		float v = fabsf(samples[i]);
+		ch_max[i % channels] = fmaxf(ch_max[i % channels], v);
+		s += v * v;
+	}
+	*sumsq = s;
+}
+
+#if defined(__GNUC__)
+typedef float v4f __attribute__((vector_size(16)));
+typedef int32_t v4i __attribute__((vector_size(16)));
+
+// Walks the buffer in blocks of lcm(channels, 4) samples with GCC vector extensions, which compile to SSE/NEON where
+// available.  Every lane of the accumulators then always sees the same channel, so deinterleaving is a single fold at
+// the end.  Fragments of less than two blocks, like the single frame of the default meter-fragment, take the plain
+// loop, which is faster than the setup and the fold at that size.
+void scan_float32(const float *samples, size_t frames, unsigned channels, float *ch_max, float *sumsq) {
+	size_t block = channels;
+	while (block % 4 != 0)
+		block += channels;
+	if (frames * channels < 2 * block) {
+		scan_float32_scalar(samples, frames, channels, ch_max, sumsq);
+		return;
+	}
+	size_t vecs = block / 4;
+	v4f vmax[SCAN_CHANNELS_MAX];
+	v4f vsum = {0, 0, 0, 0};
+	for (size_t k = 0; k < vecs; k++)
+		vmax[k] = vsum;
+	const v4i abs_mask = {0x7fffffff, 0x7fffffff, 0x7fffffff, 0x7fffffff};
+
+	size_t n = frames * channels;
+	size_t i = 0;
+	for (; i + block <= n; i += block) {
+		for (size_t k = 0; k < vecs; k++) {
+			v4f v;
+			memcpy(&v, samples + i + k * 4, sizeof(v));
+			v = (v4f)((v4i)v & abs_mask);
+			v4i gt = v > vmax[k];
+			vmax[k] = (v4f)(((v4i)v & gt) | ((v4i)vmax[k] & ~gt));
+			vsum += v * v;
+		}
+	}
+
+	for (unsigned c = 0; c < channels; c++)
+		ch_max[c] = 0;
+	for (size_t k = 0; k < vecs; k++) {
+		for (size_t l = 0; l < 4; l++)
+			ch_max[(k * 4 + l) % channels] = fmaxf(ch_max[(k * 4 + l) % channels], vmax[k][l]);
+	}
+	float s = (vsum[0] + vsum[1]) + (vsum[2] + vsum[3]);
+	// blocks hold whole frames, so the tail starts at channel 0
+	for (; i < n; i++) {
+		float v = fabsf(samples[i]);
+		ch_max[i % channels] = fmaxf(ch_max[i % channels], v);
+		s += v * v;
+	}
+	*sumsq = s;
+}
+#else
+void scan_float32(const float *samples, size_t frames, unsigned channels, float *ch_max, float *sumsq) {
+	scan_float32_scalar(samples, frames, channels, ch_max, sumsq);
+}
+#endif
+
+// the integer formats only exist to cut bandwidth, their few samples are converted with plain loops
+void scan_s16(const int16_t *samples, size_t frames, unsigned channels, float *ch_max, float *sumsq) {
+	int m[SCAN_CHANNELS_MAX] = {0};
+	float s = 0;
+	for (size_t i = 0; i < frames * channels; i++) {
+		int v = abs(samples[i]);
+		m[i % channels] = v > m[i % channels] ? v : m[i % channels];
+		s += (float)v * (float)v;
+	}
+	for (unsigned c = 0; c < channels; c++)
+		ch_max[c] = m[c] / 32767.0f;
+	*sumsq = s / (32767.0f * 32767.0f);
+}
+
+// u8 is offset binary, 128 is silence
+void scan_u8(const uint8_t *samples, size_t frames, unsigned channels, float *ch_max, float *sumsq) {
+	int m[SCAN_CHANNELS_MAX] = {0};
+	float s = 0;
+	for (size_t i = 0; i < frames * channels; i++) {
+		int v = abs(samples[i] - 128);
+		m[i % channels] = v > m[i % channels] ? v : m[i % channels];
+		s += (float)(v * v);
+	}
+	for (unsigned c = 0; c < channels; c++)
+		ch_max[c] = m[c] / 127.0f;
+	*sumsq = s / (127.0f * 127.0f);
+}
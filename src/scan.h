@@ -0,0 +1,19 @@
+#ifndef _SCAN_H
+#define _SCAN_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// PA_CHANNELS_MAX, the scanners don't depend on libpulse
+#define SCAN_CHANNELS_MAX 32
+
+// The scanners of the monitor streams reduce `frames` interleaved frames of `channels` samples, at most
+// SCAN_CHANNELS_MAX, to the largest magnitude per channel in `ch_max` and the sum of squares of all samples in `sumsq`.
+// Magnitudes are in full scale.
+void scan_float32(const float *samples, size_t frames, unsigned channels, float *ch_max, float *sumsq);
+// the plain loop `scan_float32` is checked and measured against, also used where vector extensions are missing
+void scan_float32_scalar(const float *samples, size_t frames, unsigned channels, float *ch_max, float *sumsq);
+void scan_s16(const int16_t *samples, size_t frames, unsigned channels, float *ch_max, float *sumsq);
+void scan_u8(const uint8_t *samples, size_t frames, unsigned channels, float *ch_max, float *sumsq);
+
+#endif
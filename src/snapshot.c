@@ -0,0 +1,280 @@
+#include "snapshot.h"
+#include "app.h"
+#include "da.h"
+#include "intern.h"
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Native byte order, the file never leaves the machine.  All integers are 32 bit, strings are a length, the bytes and
+// a NUL, so they are used straight from the mapping.
+//   header:  magic, version, number of sink names, source names and entries of each tab
+//   device:  index, description
+//   entry:   type, pa_index, monitor_index, flags, volume channels, map channels, volumes, positions,
+//            name, application, title, subtitle, then the device index of streams or the current port and
+//            the ports or profiles of devices and cards
+#define SNAPSHOT_MAGIC 0x584d4150u
+#define SNAPSHOT_VERSION 1
+
+enum {
+	SNAP_MUTED = 1 << 0,
+	SNAP_CORKED = 1 << 1,
+	SNAP_VOLUME_LOCK = 1 << 2,
+};
+
+static void write_u32(FILE *f, uint32_t v) {
+	fwrite(&v, sizeof(v), 1, f);
+}
+
+static void write_str(FILE *f, const char *s) {
+	if (s == NULL)
+		s = "";
+	uint32_t len = strlen(s);
+	write_u32(f, len);
+	fwrite(s, 1, len + 1, f);
+}
+
+static void write_device_names(FILE *f, const DeviceNames *names) {
+	for (size_t i = 0; i < names->len; i++) {
+		write_u32(f, names->items[i].index);
+		write_str(f, names->items[i].description.text);
+	}
+}
+
+static void write_entry(FILE *f, const Entry *ent) {
+	const EntryDetail *detail = ent->detail;
+	write_u32(f, ent->type);
+	write_u32(f, ent->pa_index);
+	write_u32(f, ent->monitor_index);
+	write_u32(f, (ent->muted ? SNAP_MUTED : 0) | (ent->corked ? SNAP_CORKED : 0) |
+	             (ent->volume_lock ? SNAP_VOLUME_LOCK : 0));
+	write_u32(f, detail->volume.channels);
+	write_u32(f, detail->channel_map.channels);
+	for (uint8_t i = 0; i < detail->volume.channels; i++)
+		write_u32(f, detail->volume.values[i]);
+	for (uint8_t i = 0; i < detail->channel_map.channels; i++)
+		write_u32(f, (uint32_t)detail->channel_map.map[i]);
+	write_str(f, ent->name);
+	write_str(f, ent->application);
+	write_str(f, detail->title.text);
+	write_str(f, detail->subtitle.text);
+	if (ent->type == ENTRY_SINKINPUT || ent->type == ENTRY_SOURCEOUTPUT) {
+		write_u32(f, detail->data.device.index);
+		return;
+	}
+	write_u32(f, (uint32_t)detail->data.ports.current);
+	write_u32(f, detail->data.ports.len);
+	for (size_t i = 0; i < detail->data.ports.len; i++) {
+		write_str(f, detail->data.ports.items[i].name);
+		write_str(f, detail->data.ports.items[i].description);
+	}
+}
+
+// create the directories leading to `path`, like the cache directory on a fresh account
+static bool make_parents(const char *path) {
+	char dir[PATH_MAX];
+	if (snprintf(dir, sizeof(dir), "%s", path) >= (int)sizeof(dir))
+		return false;
+	for (char *p = dir + 1; *p != '\0'; p++) {
+		if (*p != '/')
+			continue;
+		*p = '\0';
+		// the XDG base directory spec asks for 0700
+		bool ok = mkdir(dir, 0700) == 0 || errno == EEXIST;
+		*p = '/';
+		if (!ok)
+			return false;
+	}
+	return true;
+}
+
+bool snapshot_save(const char *path) {
+	char tmp[PATH_MAX];
+	if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp))
+		return false;
+	if (!make_parents(path))
+		return false;
+	FILE *f = fopen(tmp, "wb");
+	if (f == NULL)
+		return false;
+
+	write_u32(f, SNAPSHOT_MAGIC);
+	write_u32(f, SNAPSHOT_VERSION);
+	write_u32(f, app.sink_names.len);
+	write_u32(f, app.source_names.len);
+	for (size_t t = 0; t <= ENTRY_CARD; t++)
+		write_u32(f, app.entries[t].len);
+	write_device_names(f, &app.sink_names);
+	write_device_names(f, &app.source_names);
+	for (size_t t = 0; t <= ENTRY_CARD; t++) {
+		for (size_t i = 0; i < app.entries[t].len; i++)
+			write_entry(f, &app.entries[t].items[i]);
+	}
+
+	// replace the old snapshot only with a complete one, which is on disk before the rename
+	bool ok = fflush(f) == 0 && !ferror(f);
+	ok &= fsync(fileno(f)) == 0;
+	ok &= fclose(f) == 0;
+	if (ok)
+		ok = rename(tmp, path) == 0;
+	if (!ok)
+		unlink(tmp);
+	return ok;
+}
+
+// reads past the end fail the whole snapshot
+typedef struct {
+	const char *p;
+	const char *end;
+	bool ok;
+} Reader;
+
+static uint32_t read_u32(Reader *r) {
+	uint32_t v = 0;
+	if (r->end - r->p < (ptrdiff_t)sizeof(v)) {
+		r->ok = false;
+		return 0;
+	}
+	memcpy(&v, r->p, sizeof(v));
+	r->p += sizeof(v);
+	return v;
+}
+
+static const char *read_str(Reader *r) {
+	uint32_t len = read_u32(r);
+	if (!r->ok || (size_t)(r->end - r->p) <= len || r->p[len] != '\0') {
+		r->ok = false;
+		return "";
+	}
+	const char *s = r->p;
+	r->p += len + 1;
+	return s;
+}
+
+static void read_device_names(Reader *r, DeviceNames *names, uint32_t count) {
+	for (uint32_t i = 0; i < count && r->ok; i++) {
+		DeviceName name = {.index = read_u32(r)};
+		label_set(&name.description, read_str(r));
+		da_append(names, name);
+	}
+}
+
+static bool read_entry(Reader *r, entry_type type) {
+	if (read_u32(r) != type)
+		return false;
+	uint32_t pa_index = read_u32(r);
+	uint32_t monitor_index = read_u32(r);
+	uint32_t flags = read_u32(r);
+	EntryDetail *detail = calloc(1, sizeof(*detail));
+	assert(detail != NULL);
+	Entry ent = {
+		.type = type,
+		.pa_index = pa_index,
+		.monitor_index = monitor_index,
+		.detail = detail,
+	};
+	ent.muted = flags & SNAP_MUTED;
+	ent.corked = flags & SNAP_CORKED;
+	ent.volume_lock = flags & SNAP_VOLUME_LOCK;
+	uint32_t channels = read_u32(r);
+	uint32_t map_channels = read_u32(r);
+	if (channels > PA_CHANNELS_MAX || map_channels > PA_CHANNELS_MAX)
+		r->ok = false;
+	for (uint32_t i = 0; i < channels && r->ok; i++)
+		detail->volume.values[i] = read_u32(r);
+	for (uint32_t i = 0; i < map_channels && r->ok; i++)
+		detail->channel_map.map[i] = (pa_channel_position_t)read_u32(r);
+	detail->volume.channels = channels;
+	detail->channel_map.channels = map_channels;
+	ent.channels = channels;
+
+	ent.name = intern(read_str(r));
+	ent.application = strdup(read_str(r));
+	label_set(&detail->title, read_str(r));
+	label_set(&detail->subtitle, read_str(r));
+	if (type == ENTRY_SINKINPUT || type == ENTRY_SOURCEOUTPUT) {
+		detail->data.device.index = read_u32(r);
+	} else {
+		detail->data.ports.current = (int)read_u32(r);
+		uint32_t n = read_u32(r);
+		for (uint32_t i = 0; i < n && r->ok; i++) {
+			const char *name = read_str(r);
+			const char *description = read_str(r);
+			NameDesc port = {
+				.name = intern(name),
+				.description = intern(description),
+				.width = text_width(description),
+			};
+			da_append(&detail->data.ports, port);
+		}
+		if (detail->data.ports.current < -1 || detail->data.ports.current >= (int)detail->data.ports.len)
+			r->ok = false;
+	}
+
+	Entries *ents = &app.entries[type];
+	if (!r->ok || entries_find(ents, type, ent.pa_index) != -1) {
+		entry_free(&ent);
+		return false;
+	}
+	entries_append(ents, ent);
+	return true;
+}
+
+static void clear_all(void) {
+	for (size_t t = 0; t <= ENTRY_CARD; t++) {
+		for (size_t i = 0; i < app.entries[t].len; i++)
+			entry_free(&app.entries[t].items[i]);
+		app.entries[t].len = 0;
+		entries_reindex(&app.entries[t]);
+	}
+	for (size_t i = 0; i < app.sink_names.len; i++)
+		label_free(&app.sink_names.items[i].description);
+	for (size_t i = 0; i < app.source_names.len; i++)
+		label_free(&app.source_names.items[i].description);
+	app.sink_names.len = 0;
+	app.source_names.len = 0;
+}
+
+bool snapshot_load(const char *path) {
+	int fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd < 0)
+		return false;
+	struct stat st;
+	if (fstat(fd, &st) != 0 || st.st_size == 0) {
+		close(fd);
+		return false;
+	}
+	void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return false;
+
+	Reader r = {.p = map, .end = (const char *)map + st.st_size, .ok = true};
+	bool ok = read_u32(&r) == SNAPSHOT_MAGIC && read_u32(&r) == SNAPSHOT_VERSION;
+	uint32_t n_sinks = read_u32(&r);
+	uint32_t n_sources = read_u32(&r);
+	uint32_t n_entries[ENTRY_CARD + 1];
+	for (size_t t = 0; t <= ENTRY_CARD; t++)
+		n_entries[t] = read_u32(&r);
+	if (ok && r.ok) {
+		read_device_names(&r, &app.sink_names, n_sinks);
+		read_device_names(&r, &app.source_names, n_sources);
+		for (size_t t = 0; t <= ENTRY_CARD && ok; t++) {
+			for (uint32_t i = 0; i < n_entries[t] && ok; i++)
+				ok = read_entry(&r, (entry_type)t);
+		}
+	}
+	ok &= r.ok;
+	munmap(map, st.st_size);
+	if (!ok)
+		clear_all();
+	return ok;
+}
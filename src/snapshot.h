@@ -0,0 +1,13 @@
+#ifndef _SNAPSHOT_H
+#define _SNAPSHOT_H
+
+#include <stdbool.h>
+
+// The entries of all tabs and the device names, saved at exit so the next start can paint them before the server
+// answers.  Loaded entries are provisional until the first resync replaces them, see `App.provisional`.
+// caller should hold app-mutex
+bool snapshot_save(const char *path);
+// only into empty caches
+bool snapshot_load(const char *path);
+
+#endif
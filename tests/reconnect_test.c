@@ -0,0 +1,59 @@
+// The backoff of `reconnect_delay`: the first retry is immediate, later ones double from RECONNECT_MIN_DELAY up to
+// RECONNECT_MAX_DELAY, and each is jittered over the upper half of its delay.
+#define main pamix_main
+#include "../src/main.c"
+#undef main
+
+int main(void) {
+	jitter_state = 12345;
+	reconnect_attempts = 0;
+	if (reconnect_delay() != 0) {
+		fprintf(stderr, "the first retry waits\n");
+		return 1;
+	}
+
+	// growth up to the cap
+	pa_usec_t expected = RECONNECT_MIN_DELAY;
+	for (unsigned attempt = 2; attempt <= 20; attempt++) {
+		pa_usec_t delay = reconnect_delay();
+		if (delay < expected / 2 || delay > expected) {
+			fprintf(stderr, "attempt %u waits %llu us, expected %llu to %llu us\n", attempt,
+			        (unsigned long long)delay, (unsigned long long)expected / 2, (unsigned long long)expected);
+			return 1;
+		}
+		expected = expected * 2 < RECONNECT_MAX_DELAY ? expected * 2 : RECONNECT_MAX_DELAY;
+	}
+
+	// at the cap the jitter covers the upper half of the delay, not a single value
+	pa_usec_t lowest = RECONNECT_MAX_DELAY, highest = 0;
+	for (unsigned i = 0; i < 1000; i++) {
+		pa_usec_t delay = reconnect_delay();
+		if (delay < RECONNECT_MAX_DELAY / 2 || delay > RECONNECT_MAX_DELAY) {
+			fprintf(stderr, "capped delay of %llu us\n", (unsigned long long)delay);
+			return 1;
+		}
+		lowest = delay < lowest ? delay : lowest;
+		highest = delay > highest ? delay : highest;
+	}
+	if (lowest > RECONNECT_MAX_DELAY * 11 / 20 || highest < RECONNECT_MAX_DELAY * 19 / 20) {
+		fprintf(stderr, "capped delays only span %llu to %llu us\n", (unsigned long long)lowest,
+		        (unsigned long long)highest);
+		return 1;
+	}
+
+	// two clients with different seeds don't retry in step
+	reconnect_attempts = 5;
+	jitter_state = 1;
+	pa_usec_t first = reconnect_delay();
+	reconnect_attempts = 5;
+	jitter_state = 2;
+	if (reconnect_delay() == first) {
+		fprintf(stderr, "different seeds gave the same delay\n");
+		return 1;
+	}
+
+	printf("backoff from %llu us to %llu us, capped jitter %llu to %llu us\n",
+	       (unsigned long long)RECONNECT_MIN_DELAY, (unsigned long long)RECONNECT_MAX_DELAY,
+	       (unsigned long long)lowest, (unsigned long long)highest);
+	return 0;
+}
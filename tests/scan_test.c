@@ -0,0 +1,46 @@
+// The vector float32 scan against the scalar loop, for every channel count up to 8 and frame counts that leave
+// partial blocks.  Maxima must match exactly, the sums of squares only up to rounding since they are added in another
+// order.
+#include "scan.h"
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MAX_FRAMES 1025
+
+int main(void) {
+	static const size_t frame_counts[] = {0, 1, 3, 5, 7, 13, 127, 255, MAX_FRAMES};
+	// one more sample, so the scans also run on a buffer that isn't 16-byte aligned
+	static float buf[MAX_FRAMES * 8 + 1];
+	srand(1);
+	for (size_t i = 0; i < sizeof(buf) / sizeof(*buf); i++)
+		buf[i] = (float)rand() / RAND_MAX * 2.4f - 1.2f;
+
+	size_t checked = 0;
+	for (unsigned channels = 1; channels <= 8; channels++) {
+		for (size_t f = 0; f < sizeof(frame_counts) / sizeof(*frame_counts); f++) {
+			for (size_t offset = 0; offset <= 1; offset++) {
+				size_t frames = frame_counts[f];
+				float vec_max[8], ref_max[8], vec_sum, ref_sum;
+				scan_float32(buf + offset, frames, channels, vec_max, &vec_sum);
+				scan_float32_scalar(buf + offset, frames, channels, ref_max, &ref_sum);
+				for (unsigned c = 0; c < channels; c++) {
+					if (vec_max[c] != ref_max[c]) {
+						fprintf(stderr, "%u channels, %zu frames: max of channel %u is %f, expected %f\n",
+						        channels, frames, c, vec_max[c], ref_max[c]);
+						return 1;
+					}
+				}
+				if (fabsf(vec_sum - ref_sum) > 1e-4f * (ref_sum + 1)) {
+					fprintf(stderr, "%u channels, %zu frames: sum of squares is %f, expected %f\n", channels, frames,
+					        vec_sum, ref_sum);
+					return 1;
+				}
+				checked++;
+			}
+		}
+	}
+	printf("%zu scans match\n", checked);
+	return 0;
+}
@@ -0,0 +1,68 @@
+// Held volume keys queue many changes between two frames, `flush_volume_changes` sends only the final volume.  The
+// set-volume call is replaced through `-Wl,--wrap` to count the requests without a server.
+#define main pamix_main
+#include "../src/main.c"
+#undef main
+
+static unsigned requests;
+static pa_cvolume requested;
+
+pa_operation *__wrap_pa_context_set_sink_volume_by_index(pa_context *c, uint32_t idx, const pa_cvolume *volume,
+                                                         pa_context_success_cb_t cb, void *userdata) {
+	(void)c, (void)idx, (void)cb, (void)userdata;
+	static char op;
+	requests++;
+	requested = *volume;
+	return (pa_operation *)&op;
+}
+
+int main(void) {
+	Config cfg = {0};
+	cfg.keymap['l'] = (Action){.type = ACTION_VOLUME_ADD, .data.volume = 0.01f};
+	app_init(&app, NULL, NULL, pa_mainloop_new());
+	app.entry_page = ENTRY_SINK;
+
+	EntryDetail *detail = calloc(1, sizeof(*detail));
+	if (detail == NULL) {
+		fprintf(stderr, "out of memory\n");
+		return 1;
+	}
+	pa_channel_map_init_stereo(&detail->channel_map);
+	pa_cvolume_set(&detail->volume, 2, PA_VOLUME_NORM / 2);
+	entries_append(&app.entries[ENTRY_SINK],
+	               (Entry){.type = ENTRY_SINK, .pa_index = 1, .channels = 2, .volume_lock = true, .detail = detail});
+
+	const unsigned keys = 10;
+	for (unsigned i = 0; i < keys; i++) {
+		if (!input_queue_push(&app.input_queue, (InputEvent){.keycode = 'l', .keyname = "l"})) {
+			fprintf(stderr, "input queue full after %u keys\n", i);
+			return 1;
+		}
+	}
+	drain_input_queue(&cfg);
+	if (requests != 0 || !app.volume_dirty) {
+		fprintf(stderr, "the volume keys sent %u requests before the frame\n", requests);
+		return 1;
+	}
+
+	flush_volume_changes(&cfg);
+	if (requests != 1 || app.volume_dirty) {
+		fprintf(stderr, "%u volume keys sent %u requests, expected 1\n", keys, requests);
+		return 1;
+	}
+	pa_volume_t expected = PA_VOLUME_NORM / 2 + keys * (pa_volume_t)(PA_VOLUME_NORM * 0.01f);
+	if (pa_cvolume_avg(&requested) != expected) {
+		fprintf(stderr, "sent volume %u, expected %u\n", pa_cvolume_avg(&requested), expected);
+		return 1;
+	}
+
+	// nothing changed since, the next frame sends nothing
+	flush_volume_changes(&cfg);
+	if (requests != 1) {
+		fprintf(stderr, "an unchanged frame sent %u more requests\n", requests - 1);
+		return 1;
+	}
+
+	printf("%u volume keys, %u request\n", keys, requests);
+	return 0;
+}